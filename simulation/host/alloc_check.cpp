@@ -0,0 +1,103 @@
+// alloc_check: verifies that stepping controllers never touches the heap.
+//
+// Sizes every structure the stepping path uses (controller bank, rollup
+// cubes, jitter histogram, transition log) during setup, runs a warm-up, then
+// switches to the steady phase and runs the remaining steps. Any malloc in
+// the steady phase makes it exit non-zero.
+//
+// Usage: alloc_check [-n intersections] [-s steps] [-w warmup_steps]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "alloc_count.h"
+#include "controller_bank.h"
+#include "fixed_ring.h"
+#include "rollup.h"
+#include "rt.h"
+#include "trace.h"
+
+const int ROLLUP_SITES = 4; // Cubes are ~400 KB each, so only a few carry rollups
+
+static uint32_t xorshift(uint32_t &s) {
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return s;
+}
+
+int main(int argc, char **argv) {
+  int count = 256;
+  unsigned long long steps = 5000000;
+  unsigned long long warmup = 10000;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:s:w:")) != -1) {
+    switch (opt) {
+      case 'n': count = atoi(optarg); break;
+      case 's': steps = strtoull(optarg, NULL, 10); break;
+      case 'w': warmup = strtoull(optarg, NULL, 10); break;
+      default:
+        fprintf(stderr, "Usage: %s [-n intersections] [-s steps] [-w warmup_steps]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (count < ROLLUP_SITES) count = ROLLUP_SITES;
+
+  // --- Setup: every buffer is sized here ---
+  ControllerBank bank;
+  initBank(bank, count, DEFAULT_TIMING, 0);
+  static RollupCube cubes[ROLLUP_SITES];
+  static RollupTracker trackers[ROLLUP_SITES];
+  for (int i = 0; i < ROLLUP_SITES; i++) {
+    initRollupCube(cubes[i]);
+    initRollupTracker(trackers[i], 0);
+  }
+  static JitterHistogram jitter;
+  initJitter(jitter, 50000);
+  FixedRing<TransitionRecord> log;
+  log.init(4096);
+
+  // Each step is one loop() pass of one intersection; rounds are 10 ms apart
+  uint32_t seed = 12345;
+  unsigned long long transitions = 0;
+  allocSetPhase(ALLOC_PHASE_WARMUP);
+  for (unsigned long long step = 0; step < steps; step++) {
+    if (step == warmup) allocSetPhase(ALLOC_PHASE_STEADY);
+
+    int id = (int)(step % count);
+    unsigned long now = (unsigned long)(step / count) * 10;
+    uint8_t inputs = bank.inputs[id];
+    uint32_t r = xorshift(seed);
+    if (r % 2000 == 0) inputs ^= (uint8_t)(1 << (r >> 16) % 5); // Toggle one input now and then
+
+    uint8_t from = bank.state[id];
+    bool changed = inputs != bank.inputs[id] ? applyBankInputs(bank, id, inputs, now)
+                                             : stepBank(bank, id, now);
+    if (id < ROLLUP_SITES) rollupInputs(cubes[id], trackers[id], inputs, now);
+    if (changed) {
+      TransitionRecord rec = { (uint32_t)now, from, bank.state[id], 0, 0 };
+      log.pushOverwrite(rec);
+      if (id < ROLLUP_SITES) rollupTransition(cubes[id], trackers[id], (StateType)bank.state[id], now);
+      transitions++;
+    }
+    recordJitter(jitter, (long long)(r % 20000));
+  }
+
+  // Report after the run so printf's own buffers do not count
+  AllocCounters steady = allocCounters(ALLOC_PHASE_STEADY);
+  allocSetPhase(ALLOC_PHASE_SETUP);
+  printf("%llu steps, %llu transitions, %zu logged (%llu overwritten)\n", steps, transitions,
+         log.size(), log.dropped);
+  for (int p = 0; p < NUM_ALLOC_PHASES; p++) {
+    AllocCounters c = allocCounters((AllocPhase)p);
+    printf("%-7s %llu allocs, %llu frees, %llu bytes\n", allocPhaseName((AllocPhase)p), c.allocs,
+           c.frees, c.bytes);
+  }
+  if (steady.allocs != 0) {
+    fprintf(stderr, "FAIL: %llu allocations after warm-up\n", steady.allocs);
+    return 1;
+  }
+  printf("PASS: no allocations after warm-up\n");
+  return 0;
+}
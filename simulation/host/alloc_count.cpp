@@ -0,0 +1,95 @@
+#include "alloc_count.h"
+
+#include <atomic>
+#include <errno.h>
+#include <stddef.h>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+// Plain counters with relaxed atomics: the wrappers run on every thread and
+// must not allocate or take locks themselves
+static std::atomic<int> current_phase(ALLOC_PHASE_SETUP);
+static std::atomic<unsigned long long> phase_allocs[NUM_ALLOC_PHASES];
+static std::atomic<unsigned long long> phase_frees[NUM_ALLOC_PHASES];
+static std::atomic<unsigned long long> phase_bytes[NUM_ALLOC_PHASES];
+
+static void countAlloc(size_t size) {
+  int phase = current_phase.load(std::memory_order_relaxed);
+  phase_allocs[phase].fetch_add(1, std::memory_order_relaxed);
+  phase_bytes[phase].fetch_add(size, std::memory_order_relaxed);
+}
+
+static void countFree(void *ptr) {
+  if (!ptr) return;
+  int phase = current_phase.load(std::memory_order_relaxed);
+  phase_frees[phase].fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" {
+
+void *malloc(size_t size) {
+  countAlloc(size);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  countAlloc(count * size);
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  countAlloc(size);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+  countFree(ptr);
+  __libc_free(ptr);
+}
+
+void *memalign(size_t alignment, size_t size) {
+  countAlloc(size);
+  return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  countAlloc(size);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+  countAlloc(size);
+  void *ptr = __libc_memalign(alignment, size);
+  if (!ptr) return ENOMEM;
+  *out = ptr;
+  return 0;
+}
+
+}  // extern "C"
+
+void allocSetPhase(AllocPhase phase) {
+  current_phase.store(phase, std::memory_order_relaxed);
+}
+
+AllocCounters allocCounters(AllocPhase phase) {
+  AllocCounters c;
+  c.allocs = phase_allocs[phase].load(std::memory_order_relaxed);
+  c.frees = phase_frees[phase].load(std::memory_order_relaxed);
+  c.bytes = phase_bytes[phase].load(std::memory_order_relaxed);
+  return c;
+}
+
+const char *allocPhaseName(AllocPhase phase) {
+  switch (phase) {
+    case ALLOC_PHASE_SETUP: return "setup";
+    case ALLOC_PHASE_WARMUP: return "warmup";
+    case ALLOC_PHASE_STEADY: return "steady";
+    default: return "unknown";
+  }
+}
@@ -0,0 +1,24 @@
+// Allocation accounting for host tools.
+//
+// Linking alloc_count.cpp into a program replaces malloc, calloc, realloc,
+// free and the aligned variants with wrappers that count calls and bytes
+// against the current phase before forwarding to glibc. operator new and
+// delete reach malloc and free, so C++ allocations are counted once.
+#pragma once
+
+enum AllocPhase {
+  ALLOC_PHASE_SETUP,   // Startup: sizing pools, opening files
+  ALLOC_PHASE_WARMUP,  // First steps, where lazy initialization may still happen
+  ALLOC_PHASE_STEADY,  // Must not allocate
+  NUM_ALLOC_PHASES
+};
+
+struct AllocCounters {
+  unsigned long long allocs;  // malloc/calloc/realloc/aligned calls
+  unsigned long long frees;
+  unsigned long long bytes;   // Bytes requested
+};
+
+void allocSetPhase(AllocPhase phase);
+AllocCounters allocCounters(AllocPhase phase);
+const char *allocPhaseName(AllocPhase phase);
@@ -0,0 +1,167 @@
+#include "arduino_shim.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+
+static int pin_values[NUM_PINS];
+static int serial_fd = 1;
+static SerialSink serial_sink = NULL;
+static SerialRoom serial_room = NULL;
+static char rx_buffer[SERIAL_RX_BUFFER_SIZE];
+static unsigned rx_head = 0, rx_tail = 0; // Free-running; index modulo the size
+static unsigned long long clock_origin_ns;
+static bool clock_started = false;
+static bool virtual_clock = false;
+static unsigned long long virtual_us = 0;
+
+static unsigned long long monotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void pinMode(int pin, int mode) {
+  if (pin < 0 || pin >= NUM_PINS) return;
+  // Pull-ups read HIGH until the host drives the pin low
+  if (mode == INPUT_PULLUP) pin_values[pin] = HIGH;
+}
+
+int digitalRead(int pin) {
+  if (pin < 0 || pin >= NUM_PINS) return LOW;
+  return pin_values[pin];
+}
+
+void digitalWrite(int pin, int value) {
+  if (pin < 0 || pin >= NUM_PINS) return;
+  pin_values[pin] = value ? HIGH : LOW;
+}
+
+static unsigned long long elapsedMicros() {
+  if (virtual_clock) return virtual_us;
+  if (!clock_started) {
+    clock_origin_ns = monotonicNs();
+    clock_started = true;
+  }
+  return (monotonicNs() - clock_origin_ns) / 1000ULL;
+}
+
+unsigned long millis() { return (unsigned long)(elapsedMicros() / 1000ULL); }
+
+unsigned long micros() { return (unsigned long)elapsedMicros(); }
+
+void delay(unsigned long ms) {
+  if (virtual_clock) {
+    virtual_us += (unsigned long long)ms * 1000ULL;
+    return;
+  }
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+  }
+}
+
+// --- Serial ---
+static void serialWrite(const char *data, size_t len) {
+  if (serial_sink) {
+    serial_sink(data, len);
+    return;
+  }
+  while (len > 0) {
+    ssize_t n = write(serial_fd, data, len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    data += n;
+    len -= n;
+  }
+}
+
+void HardwareSerial::begin(unsigned long) {}
+
+int HardwareSerial::available() { return (int)(rx_tail - rx_head); }
+
+int HardwareSerial::read() {
+  if (rx_head == rx_tail) return -1;
+  return (unsigned char)rx_buffer[rx_head++ % SERIAL_RX_BUFFER_SIZE];
+}
+
+// The AVR core keeps one ring slot empty
+int HardwareSerial::availableForWrite() {
+  return serial_room ? serial_room() : SERIAL_TX_BUFFER_SIZE - 1;
+}
+
+void HardwareSerial::print(const char *text) { serialWrite(text, strlen(text)); }
+
+void HardwareSerial::print(char c) { serialWrite(&c, 1); }
+
+void HardwareSerial::print(int value) { print((long)value); }
+
+void HardwareSerial::print(unsigned int value) { print((unsigned long)value); }
+
+void HardwareSerial::print(long value) {
+  char text[24];
+  int len = snprintf(text, sizeof(text), "%ld", value);
+  serialWrite(text, len);
+}
+
+void HardwareSerial::print(unsigned long value) {
+  char text[24];
+  int len = snprintf(text, sizeof(text), "%lu", value);
+  serialWrite(text, len);
+}
+
+// Arduino terminates lines with CR LF
+void HardwareSerial::println() { serialWrite("\r\n", 2); }
+
+void HardwareSerial::println(const char *text) {
+  print(text);
+  println();
+}
+
+void HardwareSerial::println(int value) {
+  print(value);
+  println();
+}
+
+void HardwareSerial::println(unsigned long value) {
+  print(value);
+  println();
+}
+
+// --- Host Side ---
+void shimSetPin(int pin, int value) {
+  if (pin < 0 || pin >= NUM_PINS) return;
+  pin_values[pin] = value ? HIGH : LOW;
+}
+
+int shimGetPin(int pin) {
+  if (pin < 0 || pin >= NUM_PINS) return LOW;
+  return pin_values[pin];
+}
+
+void shimSetSerialFd(int fd) { serial_fd = fd; }
+
+void shimSetSerialSink(SerialSink sink) { serial_sink = sink; }
+
+void shimSetSerialRoom(SerialRoom room) { serial_room = room; }
+
+int shimSerialRxFree() { return SERIAL_RX_BUFFER_SIZE - 1 - (int)(rx_tail - rx_head); }
+
+unsigned long shimReceiveSerial(const char *data, unsigned long len) {
+  unsigned long accepted = 0;
+  while (accepted < len && shimSerialRxFree() > 0) {
+    rx_buffer[rx_tail++ % SERIAL_RX_BUFFER_SIZE] = data[accepted++];
+  }
+  return accepted;
+}
+
+void shimUseVirtualClock() { virtual_clock = true; }
+
+void shimAdvanceMicros(unsigned long long us) { virtual_us += us; }
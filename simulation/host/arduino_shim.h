@@ -0,0 +1,84 @@
+// Minimal Arduino API for building simulation.cpp on a Linux host.
+//
+// The sketch has no #include lines because the Arduino IDE injects
+// Arduino.h; host builds do the same with `g++ -include arduino_shim.h`.
+// Pin levels live in an array that the host driver reads and writes.
+#pragma once
+
+// Arduino.h brings these in for every sketch
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const int HIGH = 1;
+const int LOW = 0;
+
+const int INPUT = 0;
+const int OUTPUT = 1;
+const int INPUT_PULLUP = 2;
+
+const int NUM_PINS = 20;
+
+// ATmega328 HardwareSerial ring buffers
+const int SERIAL_RX_BUFFER_SIZE = 64;
+const int SERIAL_TX_BUFFER_SIZE = 64;
+
+void pinMode(int pin, int mode);
+int digitalRead(int pin);
+void digitalWrite(int pin, int value);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+class HardwareSerial {
+ public:
+  void begin(unsigned long baud);
+  int available();           // Received bytes waiting in the RX buffer
+  int read();                // Next received byte, -1 if none
+  int availableForWrite();   // Bytes print() can take without blocking
+  void print(const char *text);
+  void print(char c);
+  void print(int value);
+  void print(unsigned int value);
+  void print(long value);
+  void print(unsigned long value);
+  void println();
+  void println(const char *text);
+  void println(int value);
+  void println(unsigned long value);
+};
+
+extern HardwareSerial Serial;
+
+// --- Host Side ---
+// Sketch entry points
+void setup();
+void loop();
+
+// Level driven onto an input pin by the host (e.g. a HIL rig)
+void shimSetPin(int pin, int value);
+// Level last written by the sketch to an output pin
+int shimGetPin(int pin);
+
+// File descriptor Serial writes go to (stdout by default)
+void shimSetSerialFd(int fd);
+
+// Receives Serial output instead of the file descriptor when set
+typedef void (*SerialSink)(const char *data, unsigned long len);
+void shimSetSerialSink(SerialSink sink);
+
+// Reports free TX buffer space for availableForWrite() when set; otherwise
+// writes never block and the whole buffer is always free
+typedef int (*SerialRoom)();
+void shimSetSerialRoom(SerialRoom room);
+
+// Delivers received bytes into the RX buffer. Returns how many fit; like the
+// UART, bytes arriving at a full buffer are lost.
+unsigned long shimReceiveSerial(const char *data, unsigned long len);
+int shimSerialRxFree();
+
+// Switches millis()/micros() to a clock that only moves when the host
+// advances it; delay() then advances it instead of sleeping
+void shimUseVirtualClock();
+void shimAdvanceMicros(unsigned long long us);
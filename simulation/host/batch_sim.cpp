@@ -0,0 +1,269 @@
+#include "batch_sim.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CHECKPOINT_MAGIC[4] = { 'T', 'L', 'C', 'K' };
+
+// --- Arena Layout ---
+static size_t alignUp(size_t n) {
+  return (n + SIM_ARRAY_ALIGN - 1) & ~(SIM_ARRAY_ALIGN - 1);
+}
+
+// Fills in offsets and returns the total arena size. Depends only on the
+// count, so a restored header can be checked against it.
+static size_t layoutArena(uint32_t count, uint64_t offsets[NUM_SIM_ARRAYS]) {
+  size_t at = alignUp(sizeof(SimHeader));
+  for (int a = 0; a < NUM_SIM_ARRAYS; a++) {
+    offsets[a] = at;
+    at = alignUp(at + SIM_ARRAY_ELEM_SIZE[a] * count);
+  }
+  return at;
+}
+
+// Points every array at its offset in the arena
+static void bindArrays(BatchSim &sim) {
+  char *base = (char *)sim.arena;
+  const uint64_t *off = sim.header->offsets;
+  sim.state = (uint8_t *)(base + off[SIM_STATE]);
+  sim.start_ms = (uint32_t *)(base + off[SIM_START_MS]);
+  sim.inputs = (uint8_t *)(base + off[SIM_INPUTS]);
+  sim.queue[APPROACH_NS] = (uint16_t *)(base + off[SIM_QUEUE_NS]);
+  sim.queue[APPROACH_EW] = (uint16_t *)(base + off[SIM_QUEUE_EW]);
+  sim.credit_ms[APPROACH_NS] = (uint16_t *)(base + off[SIM_CREDIT_NS]);
+  sim.credit_ms[APPROACH_EW] = (uint16_t *)(base + off[SIM_CREDIT_EW]);
+  sim.rate_vph[APPROACH_NS] = (uint16_t *)(base + off[SIM_RATE_NS]);
+  sim.rate_vph[APPROACH_EW] = (uint16_t *)(base + off[SIM_RATE_EW]);
+  sim.rng = (uint32_t *)(base + off[SIM_RNG]);
+  sim.departed[APPROACH_NS] = (uint32_t *)(base + off[SIM_DEPARTED_NS]);
+  sim.departed[APPROACH_EW] = (uint32_t *)(base + off[SIM_DEPARTED_EW]);
+  sim.wait_ms[APPROACH_NS] = (uint64_t *)(base + off[SIM_WAIT_NS]);
+  sim.wait_ms[APPROACH_EW] = (uint64_t *)(base + off[SIM_WAIT_EW]);
+  sim.ns_green_ms = (uint32_t *)(base + off[SIM_NS_GREEN_MS]);
+  sim.ew_green_ms = (uint32_t *)(base + off[SIM_EW_GREEN_MS]);
+  sim.estimate[APPROACH_NS] = (QueueEstimate *)(base + off[SIM_ESTIMATE_NS]);
+  sim.estimate[APPROACH_EW] = (QueueEstimate *)(base + off[SIM_ESTIMATE_EW]);
+
+  const uint32_t *p = sim.header->plan_ms;
+  TimingPlan plan = { p[0], p[1], p[2], p[3], p[4] };
+  sim.plan = plan;
+}
+
+bool initBatchSim(BatchSim &sim, uint32_t count, const TimingPlan &plan, uint32_t tick_ms,
+                  uint32_t seed) {
+  uint64_t offsets[NUM_SIM_ARRAYS];
+  size_t len = layoutArena(count, offsets);
+  void *arena = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (arena == MAP_FAILED) {
+    perror("mmap");
+    return false;
+  }
+
+  // Anonymous pages are zeroed: INIT at t=0, empty queues and estimates, no arrivals
+  SimHeader *h = (SimHeader *)arena;
+  memcpy(h->magic, CHECKPOINT_MAGIC, sizeof(h->magic));
+  h->version = CHECKPOINT_VERSION;
+  h->count = count;
+  h->tick_ms = tick_ms;
+  h->now_ms = 0;
+  h->arena_len = len;
+  h->plan_ms[0] = plan.ns_green_ms;
+  h->plan_ms[1] = plan.ew_green_ms;
+  h->plan_ms[2] = plan.yellow_ms;
+  h->plan_ms[3] = plan.emergency_wait_ms;
+  h->plan_ms[4] = plan.init_ms;
+  memcpy(h->offsets, offsets, sizeof(offsets));
+
+  sim.header = h;
+  sim.arena = arena;
+  sim.arena_len = len;
+  bindArrays(sim);
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t s = seed ^ (i * 0x9E3779B9u);
+    sim.rng[i] = s ? s : 1;
+    sim.ns_green_ms[i] = plan.ns_green_ms;
+    sim.ew_green_ms[i] = plan.ew_green_ms;
+  }
+  return true;
+}
+
+void freeBatchSim(BatchSim &sim) {
+  if (sim.arena) munmap(sim.arena, sim.arena_len);
+  sim.arena = NULL;
+  sim.header = NULL;
+}
+
+void setArrivalRate(BatchSim &sim, int approach, uint16_t vehicles_per_hour) {
+  for (uint32_t i = 0; i < sim.header->count; i++) sim.rate_vph[approach][i] = vehicles_per_hour;
+}
+
+// --- Stepping ---
+static uint32_t xorshift(uint32_t &s) {
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return s;
+}
+
+static bool approachGreen(StateType state, int approach) {
+  uint8_t lights = lightsForState(state);
+  return approach == APPROACH_NS ? (lights & LIGHT_NS_G) != 0 : (lights & LIGHT_EW_G) != 0;
+}
+
+// True when the detector counts this vehicle
+static bool detectorCounts(uint32_t &rng) {
+  return xorshift(rng) >= (uint32_t)(DETECTOR_MISS_PER_MILLE * 4294967296ULL / 1000);
+}
+
+static void stepIntersection(BatchSim &sim, uint32_t i, uint32_t now, uint32_t tick_ms) {
+  const QueueEstimatorConfig &detectors = DEFAULT_QUEUE_ESTIMATOR;
+  uint16_t before[NUM_APPROACHES] = { sim.queue[APPROACH_NS][i], sim.queue[APPROACH_EW][i] };
+
+  // Arrivals: Bernoulli per tick at rate * tick / 1 h, in 1/2^32 units
+  for (int a = 0; a < NUM_APPROACHES; a++) {
+    uint64_t threshold = (uint64_t)sim.rate_vph[a][i] * tick_ms * 4294967296ULL / 3600000ULL;
+    if (xorshift(sim.rng[i]) < threshold && sim.queue[a][i] < 0xFFFF) {
+      sim.queue[a][i]++;
+      if (detectorCounts(sim.rng[i])) queueArrival(sim.estimate[a][i], detectors);
+    }
+  }
+
+  uint8_t inputs = sim.inputs[i] & ~(IN_NS1 | IN_EW1);
+  if (sim.queue[APPROACH_NS][i] > 0) inputs |= IN_NS1;
+  if (sim.queue[APPROACH_EW][i] > 0) inputs |= IN_EW1;
+  sim.inputs[i] = inputs;
+
+  TimingPlan plan = sim.plan;
+  plan.ns_green_ms = sim.ns_green_ms[i];
+  plan.ew_green_ms = sim.ew_green_ms[i];
+  ControllerState c = { (StateType)sim.state[i], sim.start_ms[i] };
+  if (stepController(c, inputs, now, plan)) {
+    while (nextDeadline(c, inputs, plan) <= now) {
+      if (!stepController(c, inputs, now, plan)) break;
+    }
+  }
+  sim.state[i] = c.current_state;
+  sim.start_ms[i] = (uint32_t)c.stateStartTime;
+
+  for (int a = 0; a < NUM_APPROACHES; a++) {
+    uint16_t &queue = sim.queue[a][i];
+    sim.wait_ms[a][i] += (uint64_t)queue * tick_ms;
+    if (!approachGreen(c.current_state, a) || queue == 0) {
+      sim.credit_ms[a][i] = 0;
+      continue;
+    }
+    uint32_t credit = sim.credit_ms[a][i] + tick_ms;
+    while (credit >= SATURATION_HEADWAY_MS && queue > 0) {
+      credit -= SATURATION_HEADWAY_MS;
+      queue--;
+      sim.departed[a][i]++;
+      if (detectorCounts(sim.rng[i])) queueDeparture(sim.estimate[a][i], detectors);
+    }
+    sim.credit_ms[a][i] = (uint16_t)credit;
+  }
+
+  // Detector edges: the stop bar is occupied while anything waits, the
+  // advance detector once the queue reaches back to it
+  uint16_t reach = (uint16_t)detectors.advance_vehicles;
+  for (int a = 0; a < NUM_APPROACHES; a++) {
+    uint16_t queue = sim.queue[a][i];
+    if ((before[a] > 0) != (queue > 0)) {
+      queueStopbarEdge(sim.estimate[a][i], queue > 0, detectors);
+    }
+    if ((before[a] >= reach) != (queue >= reach)) {
+      queueAdvanceEdge(sim.estimate[a][i], queue >= reach, detectors);
+    }
+  }
+}
+
+void runBatchSim(BatchSim &sim, uint64_t ticks) {
+  uint32_t count = sim.header->count;
+  uint32_t tick_ms = sim.header->tick_ms;
+  for (uint64_t t = 0; t < ticks; t++) {
+    sim.header->now_ms += tick_ms;
+    uint32_t now = (uint32_t)sim.header->now_ms;
+    for (uint32_t i = 0; i < count; i++) stepIntersection(sim, i, now, tick_ms);
+  }
+}
+
+// --- Checkpoints ---
+bool writeCheckpoint(const BatchSim &sim, const char *path) {
+  char tmp[4096];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror(tmp);
+    return false;
+  }
+  const char *p = (const char *)sim.arena;
+  size_t left = sim.arena_len;
+  while (left > 0) {
+    ssize_t n = write(fd, p, left);
+    if (n <= 0) {
+      perror(tmp);
+      close(fd);
+      unlink(tmp);
+      return false;
+    }
+    p += n;
+    left -= n;
+  }
+  if (close(fd) != 0 || rename(tmp, path) != 0) {
+    perror(path);
+    unlink(tmp);
+    return false;
+  }
+  return true;
+}
+
+bool mapCheckpoint(const char *path, BatchSim &sim) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    perror(path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SimHeader)) {
+    fprintf(stderr, "%s: not a checkpoint\n", path);
+    close(fd);
+    return false;
+  }
+  // Private and writable: the run modifies its own copy of the pages
+  void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror(path);
+    return false;
+  }
+
+  SimHeader *h = (SimHeader *)map;
+  uint64_t offsets[NUM_SIM_ARRAYS];
+  const char *problem = NULL;
+  if (memcmp(h->magic, CHECKPOINT_MAGIC, sizeof(h->magic)) != 0) {
+    problem = "not a checkpoint";
+  } else if (h->version != CHECKPOINT_VERSION) {
+    problem = "unsupported checkpoint version";
+  } else if (h->arena_len != (uint64_t)st.st_size ||
+             layoutArena(h->count, offsets) != h->arena_len ||
+             memcmp(offsets, h->offsets, sizeof(offsets)) != 0) {
+    problem = "checkpoint layout does not match this build";
+  } else if (h->tick_ms == 0) {
+    problem = "corrupt checkpoint";
+  }
+  if (problem) {
+    fprintf(stderr, "%s: %s\n", path, problem);
+    munmap(map, st.st_size);
+    return false;
+  }
+
+  sim.header = h;
+  sim.arena = map;
+  sim.arena_len = st.st_size;
+  bindArrays(sim);
+  return true;
+}
@@ -0,0 +1,104 @@
+// Batched simulator: many intersections with point queues on one clock.
+//
+// Every intersection runs the controller FSM against its own NS and EW
+// queues: vehicles arrive at a per-approach rate, the approach's detector is
+// active while its queue is non-empty, and a green approach discharges one
+// vehicle per saturation headway. Each approach also carries the queue
+// estimate a real controller would have: an advance detector counts arrivals
+// and the stop bar counts departures (both miss a few vehicles), and their
+// edges feed queue_estimator.h.
+//
+// All state, parameters included, lives in parallel arrays carved out of one
+// contiguous arena that starts with a SimHeader. A checkpoint is the arena
+// written out verbatim, so restoring is one mmap plus pointing the arrays at
+// the offsets recorded in the header. Restores map the file privately
+// (copy-on-write), so any number of runs can fan out from one warm state.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "controller.h"
+#include "queue_estimator.h"
+#include "rollup.h"
+
+const uint32_t CHECKPOINT_VERSION = 3;
+const uint32_t SATURATION_HEADWAY_MS = 2000; // One vehicle per 2 s of green
+const size_t SIM_ARRAY_ALIGN = 64;
+const uint32_t DETECTOR_MISS_PER_MILLE = 20; // Vehicles a detector fails to count
+
+// Arrays in the arena, in layout order
+enum SimArray {
+  SIM_STATE,          // uint8_t StateType
+  SIM_START_MS,       // uint32_t stateStartTime
+  SIM_INPUTS,         // uint8_t IN_* mask
+  SIM_QUEUE_NS,       // uint16_t vehicles waiting
+  SIM_QUEUE_EW,
+  SIM_CREDIT_NS,      // uint16_t green time not yet used by a departure
+  SIM_CREDIT_EW,
+  SIM_RATE_NS,        // uint16_t arrivals per hour
+  SIM_RATE_EW,
+  SIM_RNG,            // uint32_t arrival generator state
+  SIM_DEPARTED_NS,    // uint32_t vehicles served
+  SIM_DEPARTED_EW,
+  SIM_WAIT_NS,        // uint64_t vehicle-milliseconds spent queued
+  SIM_WAIT_EW,
+  SIM_NS_GREEN_MS,    // uint32_t per-intersection green times, retuned by mpc.h
+  SIM_EW_GREEN_MS,
+  SIM_ESTIMATE_NS,    // QueueEstimate from detector events
+  SIM_ESTIMATE_EW,
+  NUM_SIM_ARRAYS
+};
+
+const size_t SIM_ARRAY_ELEM_SIZE[NUM_SIM_ARRAYS] = {
+  1, 4, 1, 2, 2, 2, 2, 2, 2, 4, 4, 4, 8, 8, 4, 4, sizeof(QueueEstimate), sizeof(QueueEstimate)
+};
+
+// First bytes of the arena and of a checkpoint file
+struct SimHeader {
+  char magic[4];                          // "TLCK"
+  uint32_t version;
+  uint32_t count;                         // Intersections
+  uint32_t tick_ms;
+  uint64_t now_ms;
+  uint64_t arena_len;
+  uint32_t plan_ms[5];                    // TimingPlan fields in declaration order
+  uint32_t reserved;
+  uint64_t offsets[NUM_SIM_ARRAYS];       // Byte offset of each array from the arena start
+};
+
+struct BatchSim {
+  SimHeader *header;
+  void *arena;
+  size_t arena_len;
+  TimingPlan plan;
+
+  uint8_t *state;
+  uint32_t *start_ms;
+  uint8_t *inputs;
+  uint16_t *queue[NUM_APPROACHES];
+  uint16_t *credit_ms[NUM_APPROACHES];
+  uint16_t *rate_vph[NUM_APPROACHES];
+  uint32_t *rng;
+  uint32_t *departed[NUM_APPROACHES];
+  uint64_t *wait_ms[NUM_APPROACHES];
+  uint32_t *ns_green_ms;
+  uint32_t *ew_green_ms;
+  QueueEstimate *estimate[NUM_APPROACHES];
+};
+
+// Allocates a fresh arena with every controller in INIT and empty queues
+bool initBatchSim(BatchSim &sim, uint32_t count, const TimingPlan &plan, uint32_t tick_ms,
+                  uint32_t seed);
+void freeBatchSim(BatchSim &sim);
+
+// Sets the arrival rate of one approach for every intersection
+void setArrivalRate(BatchSim &sim, int approach, uint16_t vehicles_per_hour);
+
+// Advances every intersection by `ticks` ticks
+void runBatchSim(BatchSim &sim, uint64_t ticks);
+
+// Writes the arena to `path` (through a temporary file and rename)
+bool writeCheckpoint(const BatchSim &sim, const char *path);
+// Maps `path` copy-on-write and binds the arrays. Prints the reason on failure.
+bool mapCheckpoint(const char *path, BatchSim &sim);
@@ -0,0 +1,114 @@
+// bench_controller: compares the table-driven controller templates with
+// stepController() on the same input stream.
+//
+// Runs one random input stream through stepController(), a RuntimeTiming
+// PlannedController and a DefaultFixedTiming PlannedController, checks that
+// all three visit the same states, and prints ns per step. The two templates
+// run the same table lookup, so they should time within noise of each other;
+// they differ in bytes per instance. Code size of the step functions can be
+// read from the binary:
+//   nm -C --size-sort bench_controller | grep step
+//
+// Usage: bench_controller [-s steps]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "controller.h"
+#include "controller_template.h"
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Out of line so each variant is one symbol in the binary
+__attribute__((noinline)) static unsigned long stepGeneric(ControllerState &c, const uint8_t *inputs,
+                                                           size_t n) {
+  unsigned long changes = 0;
+  for (size_t i = 0; i < n; i++) changes += stepController(c, inputs[i], i, DEFAULT_TIMING);
+  return changes;
+}
+
+__attribute__((noinline)) static unsigned long stepRuntime(PlannedController<RuntimeTiming> &c,
+                                                           const uint8_t *inputs, size_t n) {
+  unsigned long changes = 0;
+  for (size_t i = 0; i < n; i++) changes += c.step(inputs[i], i);
+  return changes;
+}
+
+__attribute__((noinline)) static unsigned long stepFixed(PlannedController<DefaultFixedTiming> &c,
+                                                         const uint8_t *inputs, size_t n) {
+  unsigned long changes = 0;
+  for (size_t i = 0; i < n; i++) changes += c.step(inputs[i], i);
+  return changes;
+}
+
+int main(int argc, char **argv) {
+  size_t steps = 50000000;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:")) != -1) {
+    if (opt == 's') {
+      steps = strtoull(optarg, NULL, 10);
+    } else {
+      fprintf(stderr, "Usage: %s [-s steps]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // One step per millisecond; inputs change every few seconds
+  std::vector<uint8_t> inputs(steps);
+  uint32_t seed = 1;
+  uint8_t current = 0;
+  for (size_t i = 0; i < steps; i++) {
+    seed = seed * 1664525 + 1013904223;
+    if ((seed >> 20) % 3000 == 0) {
+      current = (uint8_t)(seed >> 8) & (IN_NS_ANY | IN_EW_ANY | IN_EMERGENCY);
+      if ((seed >> 4) % 50 == 0) current |= IN_RESET;
+    }
+    inputs[i] = current;
+  }
+
+  // Equivalence over a prefix, comparing state after every step
+  size_t check = steps < 5000000 ? steps : 5000000;
+  ControllerState generic;
+  initController(generic, 0);
+  PlannedController<RuntimeTiming> runtime(DEFAULT_TIMING, 0);
+  PlannedController<DefaultFixedTiming> fixed(0);
+  for (size_t i = 0; i < check; i++) {
+    stepController(generic, inputs[i], i, DEFAULT_TIMING);
+    runtime.step(inputs[i], i);
+    fixed.step(inputs[i], i);
+    if (runtime.current() != generic.current_state || fixed.current() != generic.current_state) {
+      fprintf(stderr, "FAIL: variants diverge at step %zu (%s / %s / %s)\n", i,
+              stateName(generic.current_state), stateName(runtime.current()),
+              stateName(fixed.current()));
+      return 1;
+    }
+  }
+  printf("equivalent over %zu steps\n", check);
+
+  initController(generic, 0);
+  runtime = PlannedController<RuntimeTiming>(DEFAULT_TIMING, 0);
+  fixed = PlannedController<DefaultFixedTiming>(0);
+
+  double t0 = nowSeconds();
+  unsigned long a = stepGeneric(generic, inputs.data(), steps);
+  double t1 = nowSeconds();
+  unsigned long b = stepRuntime(runtime, inputs.data(), steps);
+  double t2 = nowSeconds();
+  unsigned long c = stepFixed(fixed, inputs.data(), steps);
+  double t3 = nowSeconds();
+
+  printf("stepController        %6.2f ns/step (%lu transitions)\n", (t1 - t0) * 1e9 / steps, a);
+  printf("PlannedController<Rt> %6.2f ns/step (%lu transitions)\n", (t2 - t1) * 1e9 / steps, b);
+  printf("PlannedController<Fx> %6.2f ns/step (%lu transitions)\n", (t3 - t2) * 1e9 / steps, c);
+  printf("bytes per instance: ControllerState %zu, runtime %zu, fixed %zu\n",
+         sizeof(ControllerState), sizeof(PlannedController<RuntimeTiming>),
+         sizeof(PlannedController<DefaultFixedTiming>));
+  return 0;
+}
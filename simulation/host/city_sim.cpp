@@ -0,0 +1,201 @@
+// city_sim: runs the batched simulator and saves or resumes checkpoints.
+//
+// A run either starts cold (-n intersections) or resumes from a checkpoint
+// (-i), advances the given amount of simulated time and optionally writes a
+// new checkpoint (-c). Resuming maps the file copy-on-write, so several runs
+// can start from the same warm checkpoint at once. With -m every
+// intersection re-picks its green times by model-predictive rollouts at the
+// given interval, starting from the detector-based queue estimates (or the
+// true queues with -o).
+//
+// With -d the intersections form a grid `cols` wide, and each one's NS and EW
+// arrival rates come from assigning `trips_vph` of gravity-model OD demand
+// between the street ends to least-cost routes (od_demand.h), in place of the
+// uniform -a rates.
+//
+// Usage: city_sim [-n intersections | -i checkpoint] [-s seconds] [-t tick_ms]
+//                 [-a ns_vph,ew_vph | -d cols,trips_vph] [-r seed] [-m mpc_interval_s] [-o]
+//                 [-c checkpoint_out]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <thread>
+
+#include "batch_sim.h"
+#include "mpc.h"
+#include "od_demand.h"
+
+const float OD_LINK_M = 250.0f;
+const float OD_SPEED_MPS = 13.9f;           // 50 km/h
+const float OD_MEAN_TRIP_LINKS = 8.0f;
+const int OD_INCREMENTS = 4;
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void printSummary(const BatchSim &sim) {
+  uint64_t departed[NUM_APPROACHES] = { 0, 0 };
+  uint64_t wait_ms[NUM_APPROACHES] = { 0, 0 };
+  uint64_t queued = 0, estimated = 0;
+  double estimate_error = 0;
+  for (uint32_t i = 0; i < sim.header->count; i++) {
+    for (int a = 0; a < NUM_APPROACHES; a++) {
+      departed[a] += sim.departed[a][i];
+      wait_ms[a] += sim.wait_ms[a][i];
+      queued += sim.queue[a][i];
+      estimated += queueVehicles(sim.estimate[a][i]);
+      float error = sim.estimate[a][i].queue - sim.queue[a][i];
+      estimate_error += error < 0 ? -error : error;
+    }
+  }
+  for (int a = 0; a < NUM_APPROACHES; a++) {
+    printf("%s: %llu vehicles served, mean delay %.1f s\n", a == APPROACH_NS ? "NS" : "EW",
+           (unsigned long long)departed[a],
+           departed[a] ? wait_ms[a] / 1000.0 / departed[a] : 0.0);
+  }
+  printf("t=%.0f s, %llu vehicles queued (%llu estimated), queue estimate off by %.2f vehicles "
+         "per approach\n",
+         sim.header->now_ms / 1000.0, (unsigned long long)queued, (unsigned long long)estimated,
+         estimate_error / (sim.header->count * NUM_APPROACHES));
+}
+
+// Sets every intersection's arrival rates from an OD assignment over a
+// `cols`-wide grid. Returns false if the count does not fill the grid.
+static bool assignGridDemand(BatchSim &sim, uint32_t cols, double trips_vph, uint32_t seed) {
+  uint32_t count = sim.header->count;
+  if (cols == 0 || count % cols != 0) {
+    fprintf(stderr, "%u intersections do not form a grid %u wide\n", count, cols);
+    return false;
+  }
+  OdGrid grid = { cols, count / cols, OD_LINK_M, OD_SPEED_MPS };
+  double start = nowSeconds();
+  OdAssignment a;
+  buildOdNetwork(a, grid, sim.plan);
+  std::vector<float> od;
+  gravityDemand(a, grid, trips_vph, OD_MEAN_TRIP_LINKS * OD_LINK_M, seed, od);
+  unsigned threads = std::thread::hardware_concurrency();
+  assignDemand(a, od, OD_INCREMENTS, threads ? threads : 1);
+
+  float max_ratio = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    for (int ap = 0; ap < NUM_APPROACHES; ap++) {
+      float v = a.arrivals[ap][i];
+      sim.rate_vph[ap][i] = v > 65535 ? 65535 : (uint16_t)(v + 0.5f);
+      float ratio = v / a.approach_capacity[ap];
+      if (ratio > max_ratio) max_ratio = ratio;
+    }
+  }
+  double turned[NUM_TURNS] = { 0, 0, 0 };
+  double moves = 0;
+  for (size_t k = 0; k < a.turns.size(); k++) {
+    turned[k % NUM_TURNS] += a.turns[k];
+    moves += a.turns[k];
+  }
+  if (moves <= 0) moves = 1;
+  fprintf(stderr,
+          "od: %u x %u grid, %u zones, %.0f trips/h assigned in %.3f s; mean route %.0f s, "
+          "through/left/right %.0f/%.0f/%.0f%%, peak approach v/c %.2f\n",
+          grid.cols, grid.rows, a.zones, a.trips, nowSeconds() - start, a.mean_cost_s,
+          100 * turned[TURN_THROUGH] / moves, 100 * turned[TURN_LEFT] / moves,
+          100 * turned[TURN_RIGHT] / moves, max_ratio);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  uint32_t count = 1000;
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  double seconds = 3600;
+  uint32_t tick_ms = 100;
+  unsigned rate_ns = 400, rate_ew = 250;
+  unsigned grid_cols = 0;
+  double trips_vph = 0;
+  uint32_t seed = 1;
+  double mpc_interval = 0;
+  bool oracle = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:i:s:t:a:d:r:m:oc:")) != -1) {
+    switch (opt) {
+      case 'n': count = strtoul(optarg, NULL, 10); break;
+      case 'i': in_path = optarg; break;
+      case 's': seconds = atof(optarg); break;
+      case 't': tick_ms = strtoul(optarg, NULL, 10); break;
+      case 'a': sscanf(optarg, "%u,%u", &rate_ns, &rate_ew); break;
+      case 'd': sscanf(optarg, "%u,%lf", &grid_cols, &trips_vph); break;
+      case 'r': seed = strtoul(optarg, NULL, 0); break;
+      case 'm': mpc_interval = atof(optarg); break;
+      case 'o': oracle = true; break;
+      case 'c': out_path = optarg; break;
+      default:
+        fprintf(stderr, "Usage: %s [-n intersections | -i checkpoint] [-s seconds] [-t tick_ms] "
+                        "[-a ns_vph,ew_vph | -d cols,trips_vph] [-r seed] [-m mpc_interval_s] [-o] "
+                        "[-c checkpoint_out]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+  if (tick_ms == 0 || count == 0) {
+    fprintf(stderr, "Tick and intersection count must be positive\n");
+    return 1;
+  }
+
+  BatchSim sim;
+  double start = nowSeconds();
+  if (in_path) {
+    if (!mapCheckpoint(in_path, sim)) return 1;
+    fprintf(stderr, "resumed %u intersections at t=%.0f s from %s in %.3f ms\n",
+            sim.header->count, sim.header->now_ms / 1000.0, in_path,
+            (nowSeconds() - start) * 1000);
+  } else {
+    if (!initBatchSim(sim, count, DEFAULT_TIMING, tick_ms, seed)) return 1;
+    setArrivalRate(sim, APPROACH_NS, rate_ns);
+    setArrivalRate(sim, APPROACH_EW, rate_ew);
+    if (grid_cols > 0 && !assignGridDemand(sim, grid_cols, trips_vph, seed)) return 1;
+  }
+
+  uint64_t ticks = (uint64_t)(seconds * 1000 / sim.header->tick_ms);
+  uint64_t chunk = ticks;
+  if (mpc_interval > 0) chunk = (uint64_t)(mpc_interval * 1000 / sim.header->tick_ms);
+  if (chunk == 0) chunk = 1;
+
+  MpcConfig mpc;
+  initMpcConfig(mpc, sim.plan);
+  mpc.oracle_queues = oracle;
+  static MpcRollouts rollouts;
+  uint64_t rollout_count = 0;
+  double mpc_seconds = 0;
+
+  start = nowSeconds();
+  for (uint64_t done = 0; done < ticks; done += chunk) {
+    if (mpc_interval > 0) {
+      double t = nowSeconds();
+      rollout_count += mpcDecide(sim, mpc, rollouts);
+      mpc_seconds += nowSeconds() - t;
+    }
+    runBatchSim(sim, ticks - done < chunk ? ticks - done : chunk);
+  }
+  double elapsed = nowSeconds() - start;
+  fprintf(stderr, "%llu ticks x %u intersections in %.3f s (%.1f M intersection-steps/s)\n",
+          (unsigned long long)ticks, sim.header->count, elapsed,
+          elapsed > 0 ? ticks * sim.header->count / (elapsed - mpc_seconds) / 1e6 : 0.0);
+  if (rollout_count > 0) {
+    fprintf(stderr, "mpc: %llu rollouts of %u s in %.3f s (%.0f rollouts/s)\n",
+            (unsigned long long)rollout_count, mpc.horizon_ms / 1000, mpc_seconds,
+            rollout_count / mpc_seconds);
+  }
+  printSummary(sim);
+
+  if (out_path) {
+    start = nowSeconds();
+    if (!writeCheckpoint(sim, out_path)) return 1;
+    fprintf(stderr, "checkpoint %s: %.1f MB in %.3f ms\n", out_path, sim.arena_len / 1e6,
+            (nowSeconds() - start) * 1000);
+  }
+  freeBatchSim(sim);
+  return 0;
+}
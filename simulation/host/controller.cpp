@@ -0,0 +1,153 @@
+#include "controller.h"
+
+const TimingPlan DEFAULT_TIMING = {
+  10000, // North-South green : 10 seconds
+  6000,  // East-West green : 6 seconds
+  2000,  // Yellow for all directions : 2 seconds
+  500,   // Wait during Emergency Transition : 0.5 seconds
+  100    // Short duration during INIT state
+};
+
+// Time the FSM must spend in `state` before it leaves with `inputs` held.
+// Returns 0 for immediate transitions and NO_DEADLINE when it never leaves.
+static unsigned long transitionDelay(StateType state, uint8_t inputs,
+                                     const TimingPlan &plan) {
+  bool ns_sensor_active = (inputs & IN_NS_ANY) != 0;
+  bool ew_sensor_active = (inputs & IN_EW_ANY) != 0;
+
+  if (inputs & IN_EMERGENCY) {
+    switch (state) {
+      case EMERGENCY_GREEN: return NO_DEADLINE;
+      case EW_YELLOW: return plan.yellow_ms;
+      case EMERGENCY_TRANS: return plan.emergency_wait_ms;
+      default: return 0;
+    }
+  }
+
+  switch (state) {
+    case INIT: return plan.init_ms;
+    case NS_GREEN: return ew_sensor_active ? plan.ns_green_ms : NO_DEADLINE;
+    case NS_YELLOW: return plan.yellow_ms;
+    case EW_GREEN: return ns_sensor_active ? plan.ew_green_ms : NO_DEADLINE;
+    case EW_YELLOW: return plan.yellow_ms;
+    default: return 0;
+  }
+}
+
+StateType nextState(StateType state, uint8_t inputs, unsigned long elapsedTime,
+                    const TimingPlan &plan) {
+  bool ns_sensor_active = (inputs & IN_NS_ANY) != 0;
+  bool ew_sensor_active = (inputs & IN_EW_ANY) != 0;
+
+  // Emergency Logic
+  if (inputs & IN_EMERGENCY) {
+    switch (state) {
+      case NS_GREEN:
+      case EMERGENCY_GREEN:
+        return EMERGENCY_GREEN;
+      case EW_GREEN:
+        return EW_YELLOW; // Change to Yellow first before switching
+      case EW_YELLOW:
+        return elapsedTime >= plan.yellow_ms ? EMERGENCY_TRANS : EW_YELLOW;
+      case EMERGENCY_TRANS:
+        return elapsedTime >= plan.emergency_wait_ms ? EMERGENCY_GREEN : EMERGENCY_TRANS;
+      case NS_YELLOW:
+      case INIT:
+      default:
+        return EMERGENCY_GREEN;
+    }
+  }
+
+  // Normal Operation Logic
+  switch (state) {
+    case INIT:
+      return elapsedTime >= plan.init_ms ? NS_GREEN : INIT;
+    case NS_GREEN:
+      return (elapsedTime >= plan.ns_green_ms && ew_sensor_active) ? NS_YELLOW : NS_GREEN;
+    case NS_YELLOW:
+      return elapsedTime >= plan.yellow_ms ? EW_GREEN : NS_YELLOW;
+    case EW_GREEN:
+      return (elapsedTime >= plan.ew_green_ms && ns_sensor_active) ? EW_YELLOW : EW_GREEN;
+    case EW_YELLOW:
+      return elapsedTime >= plan.yellow_ms ? NS_GREEN : EW_YELLOW;
+    case EMERGENCY_TRANS:
+    case EMERGENCY_GREEN:
+      return NS_GREEN; // Emergency ended, return to normal NS Green
+    default:
+      return INIT; // Should not happen
+  }
+}
+
+bool stepController(ControllerState &c, uint8_t inputs, unsigned long now,
+                    const TimingPlan &plan) {
+  // Reset has highest priority and holds the timer at zero
+  if (inputs & IN_RESET) {
+    bool changed = c.current_state != INIT;
+    c.current_state = INIT;
+    c.stateStartTime = now;
+    return changed;
+  }
+
+  StateType next = nextState(c.current_state, inputs, now - c.stateStartTime, plan);
+  if (next == c.current_state) {
+    return false;
+  }
+  c.current_state = next;
+  c.stateStartTime = now;
+  return true;
+}
+
+void noteInputChange(ControllerState &c, uint8_t old_inputs, uint8_t new_inputs,
+                     unsigned long now) {
+  if ((old_inputs & IN_RESET) && !(new_inputs & IN_RESET)) {
+    c.stateStartTime = now;
+  }
+}
+
+unsigned long nextDeadline(const ControllerState &c, uint8_t inputs,
+                           const TimingPlan &plan) {
+  if (inputs & IN_RESET) {
+    return NO_DEADLINE;
+  }
+  unsigned long delay = transitionDelay(c.current_state, inputs, plan);
+  if (delay == NO_DEADLINE) {
+    return NO_DEADLINE;
+  }
+  return c.stateStartTime + delay;
+}
+
+void initController(ControllerState &c, unsigned long now) {
+  c.current_state = INIT;
+  c.stateStartTime = now;
+}
+
+uint8_t lightsForState(StateType state) {
+  switch (state) {
+    case NS_GREEN:
+    case EMERGENCY_GREEN: // NS Green light during emergency
+      return LIGHT_NS_G;
+    case NS_YELLOW:
+      return LIGHT_NS_Y;
+    case EW_GREEN:
+      return LIGHT_EW_G;
+    case EW_YELLOW:
+    case EMERGENCY_TRANS: // EW Yellow light during transition for emergency
+      return LIGHT_EW_Y;
+    case INIT:
+    default:
+      return 0; // All lights off
+  }
+}
+
+const char *stateName(StateType state) {
+  switch (state) {
+    case INIT: return "INIT";
+    case NS_GREEN: return "NS_GREEN";
+    case NS_YELLOW: return "NS_YELLOW";
+    case EW_GREEN: return "EW_GREEN";
+    case EW_YELLOW: return "EW_YELLOW";
+    case EMERGENCY_TRANS: return "EMERGENCY_TRANS";
+    case EMERGENCY_GREEN: return "EMERGENCY_GREEN";
+    default: return "UNKNOWN";
+  }
+}
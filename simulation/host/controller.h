@@ -0,0 +1,85 @@
+// Host-side port of the loop() FSM in simulation.cpp.
+//
+// The sketch keeps its state in globals and reads time from millis(), which
+// limits it to one intersection per process. This header exposes the same
+// transition rules as a pure function over (state, inputs, elapsed time) so
+// host tools can run many controllers side by side on their own clock.
+#pragma once
+
+#include <stdint.h>
+
+// --- State Definitions (same order as simulation.cpp and Traffic_Controller.v) ---
+enum StateType : uint8_t {
+  INIT,
+  NS_GREEN,
+  NS_YELLOW,
+  EW_GREEN,
+  EW_YELLOW,
+  EMERGENCY_TRANS,
+  EMERGENCY_GREEN
+};
+
+const int NUM_STATES = 7;
+
+// --- Input Mask ---
+// Bits [3:0] follow traffic_sensors in Traffic_Controller.v.
+const uint8_t IN_NS1 = 1 << 0;
+const uint8_t IN_NS2 = 1 << 1;
+const uint8_t IN_EW1 = 1 << 2;
+const uint8_t IN_EW2 = 1 << 3;
+const uint8_t IN_EMERGENCY = 1 << 4;
+const uint8_t IN_RESET = 1 << 5;
+
+const uint8_t IN_NS_ANY = IN_NS1 | IN_NS2;
+const uint8_t IN_EW_ANY = IN_EW1 | IN_EW2;
+
+// --- Light Mask ---
+// Same layout as the light output of Traffic_Controller.v.
+const uint8_t LIGHT_NS_G = 1 << 0;
+const uint8_t LIGHT_NS_Y = 1 << 1;
+const uint8_t LIGHT_EW_G = 1 << 2;
+const uint8_t LIGHT_EW_Y = 1 << 3;
+
+// --- State Durations (in Milliseconds) ---
+struct TimingPlan {
+  unsigned long ns_green_ms;
+  unsigned long ew_green_ms;
+  unsigned long yellow_ms;
+  unsigned long emergency_wait_ms;
+  unsigned long init_ms;
+};
+
+// Durations used by simulation.cpp
+extern const TimingPlan DEFAULT_TIMING;
+
+// Returned by nextDeadline() when only an input change can move the FSM
+const unsigned long NO_DEADLINE = ~0UL;
+
+// One controller instance
+struct ControllerState {
+  StateType current_state;
+  unsigned long stateStartTime; // Time the current state was entered
+};
+
+// Computes the state loop() would move to. Reset is not handled here.
+StateType nextState(StateType state, uint8_t inputs, unsigned long elapsedTime,
+                    const TimingPlan &plan);
+
+// Applies one loop() iteration at time `now`, including the reset check.
+// Returns true when the state changed.
+bool stepController(ControllerState &c, uint8_t inputs, unsigned long now,
+                    const TimingPlan &plan);
+
+// loop() restarts the INIT timer on every pass while reset is held. Callers
+// that only step when inputs change call this first so the timer restarts
+// at the moment reset is released.
+void noteInputChange(ControllerState &c, uint8_t old_inputs, uint8_t new_inputs,
+                     unsigned long now);
+
+// Earliest time at which the state can change with the inputs held constant
+unsigned long nextDeadline(const ControllerState &c, uint8_t inputs,
+                           const TimingPlan &plan);
+
+void initController(ControllerState &c, unsigned long now);
+uint8_t lightsForState(StateType state);
+const char *stateName(StateType state);
@@ -0,0 +1,39 @@
+#include "controller_bank.h"
+
+void initBank(ControllerBank &bank, int count, const TimingPlan &plan, unsigned long now) {
+  bank.count = count;
+  bank.plan = plan;
+  bank.state.assign(count, INIT);
+  bank.start_ms.assign(count, now);
+  bank.inputs.assign(count, 0);
+  bank.deadline_ms.assign(count, now + plan.init_ms);
+}
+
+bool stepBank(ControllerBank &bank, int id, unsigned long now) {
+  ControllerState c = { (StateType)bank.state[id], bank.start_ms[id] };
+  bool changed = stepController(c, bank.inputs[id], now, bank.plan);
+
+  // A plan with zero-length durations makes the new state due at once, so keep
+  // stepping while it is.
+  while (changed && nextDeadline(c, bank.inputs[id], bank.plan) <= now) {
+    if (!stepController(c, bank.inputs[id], now, bank.plan)) break;
+  }
+
+  bank.state[id] = c.current_state;
+  bank.start_ms[id] = c.stateStartTime;
+  bank.deadline_ms[id] = nextDeadline(c, bank.inputs[id], bank.plan);
+  return changed;
+}
+
+bool applyBankInputs(ControllerBank &bank, int id, uint8_t inputs, unsigned long now) {
+  bank.inputs[id] = inputs;
+  return stepBank(bank, id, now);
+}
+
+unsigned long earliestDeadline(const ControllerBank &bank) {
+  unsigned long earliest = NO_DEADLINE;
+  for (int i = 0; i < bank.count; i++) {
+    if (bank.deadline_ms[i] < earliest) earliest = bank.deadline_ms[i];
+  }
+  return earliest;
+}
@@ -0,0 +1,29 @@
+// Fixed-size set of controllers stored as parallel arrays.
+//
+// Each array is indexed by intersection id. Hot fields used every step sit
+// in their own arrays so scanning for expired timers touches one cache line
+// per 8-64 intersections.
+#pragma once
+
+#include <vector>
+#include "controller.h"
+
+struct ControllerBank {
+  int count;
+  TimingPlan plan;
+  std::vector<uint8_t> state;             // StateType
+  std::vector<unsigned long> start_ms;    // stateStartTime
+  std::vector<uint8_t> inputs;            // Last IN_* mask received
+  std::vector<unsigned long> deadline_ms; // nextDeadline() for the current state
+};
+
+void initBank(ControllerBank &bank, int count, const TimingPlan &plan, unsigned long now);
+
+// Applies `inputs` to controller `id` and steps it. Returns true on a transition.
+bool applyBankInputs(ControllerBank &bank, int id, uint8_t inputs, unsigned long now);
+
+// Steps controller `id` with its stored inputs. Returns true on a transition.
+bool stepBank(ControllerBank &bank, int id, unsigned long now);
+
+// Earliest deadline over all controllers, or NO_DEADLINE
+unsigned long earliestDeadline(const ControllerBank &bank);
@@ -0,0 +1,135 @@
+// Controller specialized at compile time on its timing plan and phase set.
+//
+// nextState() in controller.cpp re-reads the TimingPlan and walks a switch
+// on every step. Here the FSM is three per-state tables (minimum dwell,
+// demand needed, successor) for normal and emergency operation, so each step
+// is one row load and three comparisons. With a FixedTiming plan the tables
+// are a constexpr static shared by every instance; RuntimeTiming fills a copy
+// per instance from a TimingPlan at construction, for deployments that change
+// timing in the field. Both step at the same speed: the row is still indexed
+// by the runtime state, so a fixed plan saves memory, not instructions.
+// Dispatching on the state to per-case constant rules does fold the
+// comparisons, but the indirect jump costs more than the load it removes.
+#pragma once
+
+#include "controller.h"
+
+// --- Timing Plans ---
+template <unsigned long NsGreen, unsigned long EwGreen, unsigned long Yellow,
+          unsigned long EmergencyWait, unsigned long Init>
+struct FixedTiming {
+  static constexpr bool is_fixed = true;
+  static constexpr TimingPlan plan() { return TimingPlan{ NsGreen, EwGreen, Yellow, EmergencyWait, Init }; }
+};
+
+// Same durations as DEFAULT_TIMING and simulation.cpp
+typedef FixedTiming<10000, 6000, 2000, 500, 100> DefaultFixedTiming;
+
+struct RuntimeTiming {
+  static constexpr bool is_fixed = false;
+};
+
+// --- Phase Sets ---
+// All seven states, with emergency preemption (simulation.cpp behavior)
+struct StandardPhases {
+  static constexpr bool emergency_preemption = true;
+};
+
+// Sites without a preemption receiver: the emergency input is ignored and
+// the FSM only cycles INIT and the four green/yellow phases
+struct NoPreemptionPhases {
+  static constexpr bool emergency_preemption = false;
+};
+
+// One row of the transition table
+struct PhaseRule {
+  unsigned long min_ms; // Leave once this long in the state (NO_DEADLINE: never)
+  uint8_t demand;       // IN_* bits of which at least one must be set, 0 if none
+  StateType next;
+};
+
+struct PhaseTable {
+  PhaseRule rules[2][NUM_STATES]; // [emergency][state]
+};
+
+constexpr PhaseTable buildPhaseTable(TimingPlan plan) {
+  return PhaseTable{ {
+    { // Normal operation
+      { plan.init_ms, 0, NS_GREEN },                // INIT
+      { plan.ns_green_ms, IN_EW_ANY, NS_YELLOW },   // NS_GREEN waits for EW demand
+      { plan.yellow_ms, 0, EW_GREEN },              // NS_YELLOW
+      { plan.ew_green_ms, IN_NS_ANY, EW_YELLOW },   // EW_GREEN waits for NS demand
+      { plan.yellow_ms, 0, NS_GREEN },              // EW_YELLOW
+      { 0, 0, NS_GREEN },                           // EMERGENCY_TRANS: emergency ended
+      { 0, 0, NS_GREEN },                           // EMERGENCY_GREEN: emergency ended
+    },
+    { // Emergency active
+      { 0, 0, EMERGENCY_GREEN },                    // INIT
+      { 0, 0, EMERGENCY_GREEN },                    // NS_GREEN
+      { 0, 0, EMERGENCY_GREEN },                    // NS_YELLOW
+      { 0, 0, EW_YELLOW },                          // EW_GREEN: yellow first
+      { plan.yellow_ms, 0, EMERGENCY_TRANS },       // EW_YELLOW
+      { plan.emergency_wait_ms, 0, EMERGENCY_GREEN }, // EMERGENCY_TRANS
+      { NO_DEADLINE, 0, EMERGENCY_GREEN },          // EMERGENCY_GREEN: hold
+    },
+  } };
+}
+
+// Table storage: a constexpr static for fixed plans, a member otherwise
+template <typename Timing, bool Fixed = Timing::is_fixed>
+struct PhaseTableHolder {
+  static constexpr PhaseTable table = buildPhaseTable(Timing::plan());
+  const PhaseTable &get() const { return table; }
+};
+
+// ODR definition for C++14, where a constexpr static member is not implicitly inline
+template <typename Timing, bool Fixed>
+constexpr PhaseTable PhaseTableHolder<Timing, Fixed>::table;
+
+template <typename Timing>
+struct PhaseTableHolder<Timing, false> {
+  PhaseTable table;
+  const PhaseTable &get() const { return table; }
+};
+
+template <typename Timing = DefaultFixedTiming, typename Phases = StandardPhases>
+class PlannedController : private PhaseTableHolder<Timing> {
+ public:
+  ControllerState state;
+
+  // Fixed plans
+  explicit PlannedController(unsigned long now = 0) {
+    static_assert(Timing::is_fixed, "RuntimeTiming controllers need a TimingPlan");
+    initController(state, now);
+  }
+
+  // Runtime plans
+  PlannedController(const TimingPlan &plan, unsigned long now) {
+    static_assert(!Timing::is_fixed, "Fixed controllers take their plan from Timing");
+    this->table = buildPhaseTable(plan);
+    initController(state, now);
+  }
+
+  // Same contract as stepController(): one loop() pass at `now`
+  bool step(uint8_t inputs, unsigned long now) {
+    if (inputs & IN_RESET) {
+      bool changed = state.current_state != INIT;
+      state.current_state = INIT;
+      state.stateStartTime = now;
+      return changed;
+    }
+
+    int emergency = 0;
+    if (Phases::emergency_preemption) emergency = (inputs & IN_EMERGENCY) ? 1 : 0;
+    const PhaseRule &rule = this->get().rules[emergency][state.current_state];
+
+    if (now - state.stateStartTime < rule.min_ms) return false;
+    if (rule.demand != 0 && !(inputs & rule.demand)) return false;
+    if (rule.next == state.current_state) return false;
+    state.current_state = rule.next;
+    state.stateStartTime = now;
+    return true;
+  }
+
+  StateType current() const { return state.current_state; }
+};
@@ -0,0 +1,228 @@
+// corridor_sim: car-following simulation of signalized arterial corridors.
+//
+// Runs microsim.h for the given simulated time and reports delay, stops and
+// detector occupancy for arterial and cross-street traffic, plus simulation
+// speed in vehicle-updates per second. Several independent corridors (-c)
+// scale the run up for throughput measurements. With -o the stop-bar
+// detector mask of the first intersection is written as a stimulus trace,
+// ready for coverage_report or the replay tools.
+//
+// -b retimes one intersection of every corridor with a longer EW green,
+// making it the arterial bottleneck that queues spill back from.
+//
+// -p and -g repeat the run on the same arrivals with platoon holding and early
+// calls (-p) and/or spillback gating (-g) enabled, and report the stops saved
+// per detected platoon and the change in corridor throughput.
+//
+// Usage: corridor_sim [-n intersections] [-c corridors] [-l link_m] [-s seconds]
+//                     [-t tick_ms] [-a arterial_vph,cross_vph] [-b index,ew_green_ms]
+//                     [-r seed] [-p] [-g] [-o stimulus.tlct]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "microsim.h"
+#include "trace.h"
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Totals over the arterial (NS) or cross-street (EW) lanes
+struct MovementTotals {
+  uint64_t exited;
+  uint64_t stops;
+  double delay_s;
+  uint64_t stopbar_on_ms;
+  uint64_t advance_on_ms;
+  uint64_t advance_count;
+  uint32_t lanes;
+};
+
+static void printSummary(const MicroSim &sim) {
+  MovementTotals totals[2] = {};
+  for (size_t s = 0; s < sim.segments.size(); s++) {
+    const LaneSegment &seg = sim.segments[s];
+    int lane = s % LANES_PER_INTERSECTION;
+    MovementTotals &t = totals[lane == LANE_NS1 || lane == LANE_NS2 ? 0 : 1];
+    t.exited += seg.exited;
+    t.stops += seg.stops;
+    t.delay_s += seg.delay_s;
+    t.stopbar_on_ms += seg.stopbar_on_ms;
+    t.advance_on_ms += seg.advance_on_ms;
+    t.advance_count += seg.advance_count;
+    t.lanes++;
+  }
+  double lane_ms = (double)sim.now_ms;
+  for (int m = 0; m < 2; m++) {
+    const MovementTotals &t = totals[m];
+    double trips = t.exited ? (double)t.exited : 1.0;
+    printf("%s: %llu trips, mean delay %.1f s, %.2f stops/trip, stop bar occupied %.1f%%, "
+           "advance %.1f%% (%.0f veh/h per lane)\n",
+           m == 0 ? "arterial" : "cross", (unsigned long long)t.exited, t.delay_s / trips,
+           t.stops / trips, 100.0 * t.stopbar_on_ms / (lane_ms * t.lanes),
+           100.0 * t.advance_on_ms / (lane_ms * t.lanes),
+           t.advance_count * 3600000.0 / (lane_ms * t.lanes));
+  }
+  printf("t=%.0f s, %llu vehicles on the road\n", sim.now_ms / 1000.0,
+         (unsigned long long)vehicleCount(sim));
+}
+
+// Stops on the arterial lanes and on all lanes
+static void totalStops(const MicroSim &sim, uint64_t &arterial, uint64_t &all) {
+  arterial = all = 0;
+  for (size_t s = 0; s < sim.segments.size(); s++) {
+    int lane = s % LANES_PER_INTERSECTION;
+    if (lane == LANE_NS1 || lane == LANE_NS2) arterial += sim.segments[s].stops;
+    all += sim.segments[s].stops;
+  }
+}
+
+static uint64_t totalTrips(const MicroSim &sim, double &delay_s) {
+  uint64_t trips = 0;
+  delay_s = 0;
+  for (size_t s = 0; s < sim.segments.size(); s++) {
+    trips += sim.segments[s].exited;
+    delay_s += sim.segments[s].delay_s;
+  }
+  return trips;
+}
+
+static uint64_t totalSpillbacks(const MicroSim &sim) {
+  uint64_t episodes = 0;
+  for (size_t s = 0; s < sim.spillback.size(); s++) episodes += sim.spillback[s].episodes;
+  return episodes;
+}
+
+static uint64_t totalPlatoons(const MicroSim &sim) {
+  uint64_t platoons = 0;
+  for (size_t s = 0; s < sim.platoons.size(); s++) platoons += sim.platoons[s].platoons;
+  return platoons;
+}
+
+// Runs `ticks` ticks, recording the first intersection's detector mask when
+// `stimulus` is given. Returns the vehicle-updates performed.
+static uint64_t runCorridor(MicroSim &sim, uint64_t ticks, std::vector<StimulusRecord> *stimulus) {
+  uint64_t updates = 0;
+  for (uint64_t t = 0; t < ticks; t++) {
+    updates += vehicleCount(sim);
+    stepMicroSim(sim);
+    if (stimulus && (stimulus->empty() || stimulus->back().inputs != sim.inputs[0])) {
+      StimulusRecord r = { (uint32_t)sim.now_ms, sim.inputs[0], { 0, 0, 0 } };
+      stimulus->push_back(r);
+    }
+  }
+  return updates;
+}
+
+int main(int argc, char **argv) {
+  uint32_t intersections = 5;
+  uint32_t corridors = 1;
+  float link_m = 300;
+  double seconds = 3600;
+  uint32_t tick_ms = 100;
+  unsigned rate_arterial = 600, rate_cross = 300;
+  uint32_t seed = 1;
+  const char *trace_path = NULL;
+  bool compare_platoons = false;
+  bool compare_gating = false;
+  int bottleneck = -1;
+  unsigned bottleneck_ew_ms = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:c:l:s:t:a:b:r:pgo:")) != -1) {
+    switch (opt) {
+      case 'n': intersections = strtoul(optarg, NULL, 10); break;
+      case 'c': corridors = strtoul(optarg, NULL, 10); break;
+      case 'l': link_m = atof(optarg); break;
+      case 's': seconds = atof(optarg); break;
+      case 't': tick_ms = strtoul(optarg, NULL, 10); break;
+      case 'a': sscanf(optarg, "%u,%u", &rate_arterial, &rate_cross); break;
+      case 'b': sscanf(optarg, "%d,%u", &bottleneck, &bottleneck_ew_ms); break;
+      case 'r': seed = strtoul(optarg, NULL, 0); break;
+      case 'p': compare_platoons = true; break;
+      case 'g': compare_gating = true; break;
+      case 'o': trace_path = optarg; break;
+      default:
+        fprintf(stderr, "Usage: %s [-n intersections] [-c corridors] [-l link_m] [-s seconds] "
+                        "[-t tick_ms] [-a arterial_vph,cross_vph] [-b index,ew_green_ms] "
+                        "[-r seed] [-p] [-g] [-o stimulus.tlct]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+  if (intersections == 0 || corridors == 0 || tick_ms == 0 || bottleneck >= (int)intersections ||
+      link_m < ADVANCE_DETECTOR_M + ADVANCE_DETECTOR_LEN + VEHICLE_LENGTH) {
+    fprintf(stderr, "Counts and tick must be positive, links longer than %.0f m\n",
+            ADVANCE_DETECTOR_M + ADVANCE_DETECTOR_LEN + VEHICLE_LENGTH);
+    return 1;
+  }
+
+  std::vector<StimulusRecord> stimulus;
+  uint64_t ticks = (uint64_t)(seconds * 1000 / tick_ms);
+  uint64_t arterial_stops[2] = { 0, 0 };
+  uint64_t stops[2] = { 0, 0 };
+  uint64_t trips[2] = { 0, 0 };
+  double delay_s[2] = { 0, 0 };
+  bool compare = compare_platoons || compare_gating;
+  for (int run = 0; run < (compare ? 2 : 1); run++) {
+    MicroSim sim;
+    if (!initCorridor(sim, corridors, intersections, link_m, rate_arterial, rate_cross,
+                      DEFAULT_TIMING, tick_ms, seed)) {
+      return 1;
+    }
+    if (bottleneck >= 0) {
+      for (uint32_t k = bottleneck; k < sim.plans.size(); k += intersections) {
+        sim.plans[k].ew_green_ms = bottleneck_ew_ms;
+      }
+    }
+    sim.platoon_control = run == 1 && compare_platoons;
+    sim.spillback_gating = run == 1 && compare_gating;
+
+    double start = nowSeconds();
+    uint64_t updates = runCorridor(sim, ticks, trace_path && run == 0 ? &stimulus : NULL);
+    double elapsed = nowSeconds() - start;
+
+    if (compare) {
+      printf("%s:\n", run == 0 ? "actuated"
+                     : compare_platoons && compare_gating ? "platoon holding, spillback gating"
+                     : compare_platoons ? "platoon holding" : "spillback gating");
+    }
+    fprintf(stderr, "%u x %u intersections, %llu ticks in %.3f s: %.1f M vehicle-updates/s, "
+                    "%.0fx real time\n",
+            corridors, intersections, (unsigned long long)ticks, elapsed,
+            elapsed > 0 ? updates / elapsed / 1e6 : 0.0, elapsed > 0 ? seconds / elapsed : 0.0);
+    printSummary(sim);
+    totalStops(sim, arterial_stops[run], stops[run]);
+    trips[run] = totalTrips(sim, delay_s[run]);
+    if (run == 1 && compare_platoons) {
+      uint64_t platoons = totalPlatoons(sim);
+      double saved = (double)arterial_stops[0] - arterial_stops[1];
+      printf("%llu platoons, %llu holds, %llu early calls: %.0f arterial stops saved (%.2f per "
+             "platoon), %lld saved on all lanes\n",
+             (unsigned long long)platoons, (unsigned long long)sim.holds,
+             (unsigned long long)sim.calls, saved, platoons ? saved / platoons : 0.0,
+             (long long)(stops[0] - stops[1]));
+    }
+    if (run == 1 && compare_gating) {
+      printf("%llu spillbacks, %llu skipped calls, %llu shortened greens: throughput %llu -> %llu "
+             "trips (%+.1f%%), delay per trip %.1f -> %.1f s\n",
+             (unsigned long long)totalSpillbacks(sim), (unsigned long long)sim.skips,
+             (unsigned long long)sim.shortens, (unsigned long long)trips[0],
+             (unsigned long long)trips[1],
+             trips[0] ? 100.0 * ((double)trips[1] - trips[0]) / trips[0] : 0.0,
+             trips[0] ? delay_s[0] / trips[0] : 0.0, trips[1] ? delay_s[1] / trips[1] : 0.0);
+    }
+    freeMicroSim(sim);
+  }
+
+  if (trace_path &&
+      !writeTrace(trace_path, TRACE_STIMULUS, stimulus.data(), (uint32_t)stimulus.size())) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,178 @@
+#include "coverage.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char COVERAGE_MAGIC[4] = { 'T', 'L', 'C', 'V' };
+
+void initCoverage(CoverageMap &map) {
+  memset(&map, 0, sizeof(map));
+}
+
+unsigned long stateDwell(StateType state, const TimingPlan &plan) {
+  switch (state) {
+    case INIT: return plan.init_ms;
+    case NS_GREEN: return plan.ns_green_ms;
+    case NS_YELLOW: return plan.yellow_ms;
+    case EW_GREEN: return plan.ew_green_ms;
+    case EW_YELLOW: return plan.yellow_ms;
+    case EMERGENCY_TRANS: return plan.emergency_wait_ms;
+    default: return 0;
+  }
+}
+
+void feasibleCoverage(const TimingPlan &plan, CoverageMap &feasible) {
+  initCoverage(feasible);
+  for (int s = 0; s < NUM_STATES; s++) {
+    StateType state = (StateType)s;
+    for (int inputs = 0; inputs < 64; inputs++) {
+      if (!(inputs & IN_RESET)) {
+        unsigned long dwell = stateDwell(state, plan);
+        if (dwell == 0) {
+          // Expired as soon as it is entered
+          coverCell(feasible, state, inputs, true);
+        } else {
+          coverCell(feasible, state, inputs, false);
+          // Expired: either these inputs hold the state until its timer
+          // runs out, or some other inputs hold it past that and these
+          // arrive later. A timer due in the same millisecond as an input
+          // change fires first, so nothing else reaches the cell.
+          bool reachable = nextState(state, inputs, dwell - 1, plan) == state;
+          for (int held = 0; held < 32 && !reachable; held++) {
+            reachable = nextState(state, held, dwell, plan) == state;
+          }
+          if (reachable) coverCell(feasible, state, inputs, true);
+        }
+      }
+
+      unsigned long elapsed[2] = { 0, NO_DEADLINE - 1 };
+      for (int e = 0; e < 2; e++) {
+        StateType next = (inputs & IN_RESET) ? INIT : nextState(state, inputs, elapsed[e], plan);
+        if (next != state) coverEdge(feasible, state, next);
+      }
+    }
+  }
+  feasible.samples = 0;
+}
+
+void mergeCoverage(CoverageMap &into, const CoverageMap &from) {
+  for (int i = 0; i < COVERAGE_CELL_WORDS; i++) into.cells[i] |= from.cells[i];
+  into.edges |= from.edges;
+  into.samples += from.samples;
+}
+
+// One loop() evaluation at `now`: samples the cell, steps, and follows
+// transitions that are immediately due again
+static void evaluate(ControllerState &c, uint8_t inputs, unsigned long now,
+                     const TimingPlan &plan, CoverageMap &map) {
+  for (int guard = 0; guard < NUM_STATES; guard++) {
+    StateType from = c.current_state;
+    if (!(inputs & IN_RESET)) {
+      coverCell(map, from, inputs, now - c.stateStartTime >= stateDwell(from, plan));
+    }
+    if (!stepController(c, inputs, now, plan)) return;
+    coverEdge(map, from, c.current_state);
+  }
+}
+
+void coverStimulus(const StimulusRecord *stimulus, size_t count, unsigned long start_ms,
+                   unsigned long end_ms, const TimingPlan &plan, CoverageMap &map) {
+  ControllerState c;
+  initController(c, start_ms);
+  uint8_t inputs = 0;
+  unsigned long now = start_ms;
+  evaluate(c, inputs, now, plan, map);
+
+  for (size_t i = 0; i <= count; i++) {
+    unsigned long until = i < count ? stimulus[i].t_ms : end_ms;
+
+    // Between events the cell is constant, so sampling at each transition
+    // deadline and each timer expiry sees every cell a 1 ms loop() would
+    while (!(inputs & IN_RESET)) {
+      unsigned long next = nextDeadline(c, inputs, plan);
+      unsigned long expiry = c.stateStartTime + stateDwell(c.current_state, plan);
+      if (expiry > now && expiry < next) next = expiry;
+      if (next <= now || next > until || (next == until && i == count)) break;
+      now = next;
+      evaluate(c, inputs, now, plan, map);
+    }
+    if (i == count) break;
+
+    noteInputChange(c, inputs, stimulus[i].inputs, until);
+    inputs = stimulus[i].inputs;
+    now = until;
+    evaluate(c, inputs, now, plan, map);
+  }
+}
+
+bool writeCoverage(const char *path, const CoverageMap &map) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  bool ok = fwrite(COVERAGE_MAGIC, sizeof(COVERAGE_MAGIC), 1, f) == 1 &&
+            fwrite(&map, sizeof(map), 1, f) == 1;
+  if (fclose(f) != 0) ok = false;
+  if (!ok) perror(path);
+  return ok;
+}
+
+bool readCoverage(const char *path, CoverageMap &map) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  char magic[4];
+  bool ok = fread(magic, sizeof(magic), 1, f) == 1 &&
+            memcmp(magic, COVERAGE_MAGIC, sizeof(magic)) == 0 && fread(&map, sizeof(map), 1, f) == 1;
+  fclose(f);
+  if (!ok) fprintf(stderr, "%s: not a coverage file\n", path);
+  return ok;
+}
+
+void describeCell(int cell, char *out, size_t len) {
+  snprintf(out, len, "%s emergency=%d ns=%d ew=%d timer=%s", stateName((StateType)(cell / 16)),
+           (cell & CELL_EMERGENCY) ? 1 : 0, (cell & CELL_NS_DEMAND) ? 1 : 0,
+           (cell & CELL_EW_DEMAND) ? 1 : 0, (cell & CELL_TIMER_EXPIRED) ? "expired" : "running");
+}
+
+void printCoverageReport(const CoverageMap &map, const TimingPlan &plan) {
+  CoverageMap feasible;
+  feasibleCoverage(plan, feasible);
+
+  int cells = 0, cells_hit = 0, edges = 0, edges_hit = 0;
+  for (int cell = 0; cell < COVERAGE_CELLS; cell++) {
+    if (!cellCovered(feasible, cell)) continue;
+    cells++;
+    if (cellCovered(map, cell)) {
+      cells_hit++;
+    } else {
+      char text[96];
+      describeCell(cell, text, sizeof(text));
+      printf("uncovered cell: %s\n", text);
+    }
+  }
+  for (int e = 0; e < COVERAGE_EDGES; e++) {
+    if (!((feasible.edges >> e) & 1)) continue;
+    edges++;
+    if ((map.edges >> e) & 1) {
+      edges_hit++;
+    } else {
+      printf("uncovered edge: %s -> %s\n", stateName((StateType)(e / NUM_STATES)),
+             stateName((StateType)(e % NUM_STATES)));
+    }
+  }
+  // Cells a testbench log reached that this plan never evaluates (the RTL
+  // stays in EMERGENCY_TRANS until its timer expires, for example)
+  for (int cell = 0; cell < COVERAGE_CELLS; cell++) {
+    if (cellCovered(map, cell) && !cellCovered(feasible, cell)) {
+      char text[96];
+      describeCell(cell, text, sizeof(text));
+      printf("covered beyond model: %s\n", text);
+    }
+  }
+  printf("cells %d/%d, edges %d/%d, %llu samples\n", cells_hit, cells, edges_hit, edges,
+         (unsigned long long)map.samples);
+}
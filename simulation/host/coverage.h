@@ -0,0 +1,85 @@
+// Functional coverage of the controller FSM.
+//
+// A cell is one (state, emergency, NS demand, EW demand, timer expired)
+// combination the FSM was evaluated in; an edge is one from -> to
+// transition. Both are single bits, so sampling is an index computation and
+// an OR, cheap enough to leave on for million-cycle runs, and maps from
+// parallel runs merge by OR.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trace.h"
+
+const int COVERAGE_CELLS = NUM_STATES * 16;
+const int COVERAGE_EDGES = NUM_STATES * NUM_STATES;
+const int COVERAGE_CELL_WORDS = (COVERAGE_CELLS + 63) / 64;
+
+// Bit positions inside a state's group of 16 cells
+const int CELL_EMERGENCY = 1 << 0;
+const int CELL_NS_DEMAND = 1 << 1;
+const int CELL_EW_DEMAND = 1 << 2;
+const int CELL_TIMER_EXPIRED = 1 << 3;
+
+struct CoverageMap {
+  uint64_t cells[COVERAGE_CELL_WORDS];
+  uint64_t edges;                        // Bit from * NUM_STATES + to
+  uint64_t samples;
+};
+
+void initCoverage(CoverageMap &map);
+
+inline int coverageCell(StateType state, uint8_t inputs, bool timer_expired) {
+  int cell = state * 16;
+  if (inputs & IN_EMERGENCY) cell |= CELL_EMERGENCY;
+  if (inputs & IN_NS_ANY) cell |= CELL_NS_DEMAND;
+  if (inputs & IN_EW_ANY) cell |= CELL_EW_DEMAND;
+  if (timer_expired) cell |= CELL_TIMER_EXPIRED;
+  return cell;
+}
+
+inline void coverCell(CoverageMap &map, StateType state, uint8_t inputs, bool timer_expired) {
+  int cell = coverageCell(state, inputs, timer_expired);
+  map.cells[cell >> 6] |= 1ULL << (cell & 63);
+  map.samples++;
+}
+
+inline void coverEdge(CoverageMap &map, StateType from, StateType to) {
+  map.edges |= 1ULL << (from * NUM_STATES + to);
+}
+
+inline bool cellCovered(const CoverageMap &map, int cell) {
+  return (map.cells[cell >> 6] >> (cell & 63)) & 1;
+}
+
+// Time the state's timer runs before it counts as expired (state_timer
+// reaching zero in Traffic_Controller.v)
+unsigned long stateDwell(StateType state, const TimingPlan &plan);
+
+// Cells the FSM can be evaluated in and edges it can take under `plan`
+void feasibleCoverage(const TimingPlan &plan, CoverageMap &feasible);
+
+void mergeCoverage(CoverageMap &into, const CoverageMap &from);
+
+// True when `run` has a cell or edge that `seen` lacks
+inline bool hasNewCoverage(const CoverageMap &seen, const CoverageMap &run) {
+  uint64_t fresh = run.edges & ~seen.edges;
+  for (int i = 0; i < COVERAGE_CELL_WORDS; i++) fresh |= run.cells[i] & ~seen.cells[i];
+  return fresh != 0;
+}
+
+// Runs a controller over a stimulus trace like simulateStimulus(), sampling
+// every combination it holds between start_ms and end_ms.
+void coverStimulus(const StimulusRecord *stimulus, size_t count, unsigned long start_ms,
+                   unsigned long end_ms, const TimingPlan &plan, CoverageMap &map);
+
+// Coverage file: "TLCV" followed by the map, host byte order
+bool writeCoverage(const char *path, const CoverageMap &map);
+bool readCoverage(const char *path, CoverageMap &map);
+
+// Describes a cell as "STATE emergency=0 ns=1 ew=0 timer=running"
+void describeCell(int cell, char *out, size_t len);
+
+// Prints every feasible cell and edge missing from `map`, then the totals
+void printCoverageReport(const CoverageMap &map, const TimingPlan &plan);
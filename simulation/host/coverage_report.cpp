@@ -0,0 +1,127 @@
+// coverage_report: merges FSM coverage from regression runs and lists holes.
+//
+// Each argument is one of:
+//   - a stimulus trace (.tlct), run through the controller with coverage on
+//   - a coverage file (-o output of an earlier run, e.g. one per parallel job)
+//   - a testbench coverage log, written by tb_traffic_controller.v when built
+//     with +define+COVERAGE_LOG=\"cov.log\": one line per clock of
+//     "reset emergency sensors state timer_zero"
+// The merged map is compared with every cell and edge the timing plan
+// allows, and the uncovered ones are printed.
+//
+// Usage: coverage_report [-o merged.cov] input [input ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "coverage.h"
+
+// Trailing time after the last input change so pending timers play out
+const unsigned long TRACE_TAIL_MS = 60000;
+
+// Fail-safe flash state of Traffic_Controller.v, which the C++ FSM lacks
+const int RTL_FLASH_STATE = 7;
+
+static bool coverTrace(const char *path, CoverageMap &map) {
+  MappedTrace trace;
+  if (!mapTrace(path, TRACE_STIMULUS, trace)) return false;
+  const StimulusRecord *stimulus = (const StimulusRecord *)trace.records;
+  uint32_t count = trace.header->record_count;
+  if (count > 0) {
+    coverStimulus(stimulus, count, stimulus[0].t_ms, stimulus[count - 1].t_ms + TRACE_TAIL_MS,
+                  DEFAULT_TIMING, map);
+  }
+  unmapTrace(trace);
+  return true;
+}
+
+// Parses a testbench log; cells and edges come straight from the RTL
+static bool coverRtlLog(const char *path, CoverageMap &map) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  char line[128];
+  int prev_state = -1;
+  unsigned long long bad = 0, flash = 0;
+  while (fgets(line, sizeof(line), f)) {
+    int reset, emergency, timer_zero;
+    char sensors[8], state_bits[8];
+    if (sscanf(line, "%d %d %7s %7s %d", &reset, &emergency, sensors, state_bits,
+               &timer_zero) != 5) {
+      bad++;
+      continue;
+    }
+    int state = (int)strtol(state_bits, NULL, 2);
+    if (state == RTL_FLASH_STATE && !strchr(state_bits, 'x')) {
+      flash++;
+      prev_state = -1;
+      continue;
+    }
+    if (state >= NUM_STATES || strchr(state_bits, 'x') || strchr(sensors, 'x')) {
+      bad++;
+      continue;
+    }
+    // Sensors are printed [3:0], so the first character is EW2
+    uint8_t inputs = (uint8_t)strtol(sensors, NULL, 2) & (IN_NS_ANY | IN_EW_ANY);
+    if (emergency) inputs |= IN_EMERGENCY;
+
+    if (prev_state >= 0 && prev_state != state) coverEdge(map, (StateType)prev_state, (StateType)state);
+    if (!reset) coverCell(map, (StateType)state, inputs, timer_zero != 0);
+    prev_state = state;
+  }
+  fclose(f);
+  if (bad > 0) fprintf(stderr, "%s: %llu unreadable lines\n", path, bad);
+  if (flash > 0) fprintf(stderr, "%s: %llu cycles in fail-safe flash\n", path, flash);
+  return true;
+}
+
+static bool coverInput(const char *path, CoverageMap &map) {
+  char magic[4] = { 0, 0, 0, 0 };
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  size_t n = fread(magic, 1, sizeof(magic), f);
+  fclose(f);
+
+  if (n == 4 && memcmp(magic, "TLCT", 4) == 0) return coverTrace(path, map);
+  if (n == 4 && memcmp(magic, "TLCV", 4) == 0) {
+    CoverageMap run;
+    if (!readCoverage(path, run)) return false;
+    mergeCoverage(map, run);
+    return true;
+  }
+  return coverRtlLog(path, map);
+}
+
+int main(int argc, char **argv) {
+  const char *out_path = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:")) != -1) {
+    if (opt == 'o') {
+      out_path = optarg;
+    } else {
+      optind = argc + 1;
+      break;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "Usage: %s [-o merged.cov] input [input ...]\n", argv[0]);
+    return 1;
+  }
+
+  CoverageMap map;
+  initCoverage(map);
+  for (int i = optind; i < argc; i++) {
+    if (!coverInput(argv[i], map)) return 1;
+  }
+  if (out_path && !writeCoverage(out_path, map)) return 1;
+
+  printCoverageReport(map, DEFAULT_TIMING);
+  return 0;
+}
@@ -0,0 +1,124 @@
+// csv2trace: converts detector CSV exports into stimulus traces.
+//
+// Vendor exports are one row per second per intersection, so a year of
+// history is tens of millions of rows. The file is mapped read-only and
+// split at line boundaries into one chunk per thread; each chunk is scanned
+// 64 bytes at a time for ',' and '\n' and every field is parsed as fixed-point
+// occupancy without strtod. Rows are then folded into a TRACE_STIMULUS file
+// that only records mask changes, ready for simulateStimulus() or replay.
+//
+// Usage: csv2trace [-j threads] [-o threshold] input.csv stimulus.tlct
+//   -o is the occupancy above which a detector counts as active (default 0.5;
+//      use 50 for percentage exports).
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "csv_ingest.h"
+#include "simd_scan.h"
+#include "trace.h"
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = std::thread::hardware_concurrency();
+  CsvOptions options = { 500 };
+  int opt;
+  while ((opt = getopt(argc, argv, "j:o:")) != -1) {
+    switch (opt) {
+      case 'j': threads = atoi(optarg); break;
+      case 'o': options.threshold_milli = (long)(atof(optarg) * 1000); break;
+      default:
+        optind = argc + 1;
+        break;
+    }
+  }
+  if (optind + 2 != argc) {
+    fprintf(stderr, "Usage: %s [-j threads] [-o threshold] input.csv stimulus.tlct\n", argv[0]);
+    return 1;
+  }
+  if (threads == 0) threads = 1;
+
+  int fd = open(argv[optind], O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    perror(argv[optind]);
+    return 1;
+  }
+  size_t size = st.st_size;
+  const char *data = NULL;
+  if (size > 0) {
+    data = (const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (data == MAP_FAILED) {
+      perror("mmap");
+      return 1;
+    }
+    madvise((void *)data, size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  int columns = detectCsvColumns(data, data + size);
+  if (columns == 0) {
+    fprintf(stderr, "%s: no rows with %d or %d numeric columns\n", argv[optind],
+            CSV_OCCUPANCY_COLUMNS, CSV_OCCUPANCY_COLUMNS + 1);
+    return 1;
+  }
+
+  double start = nowSeconds();
+
+  // Chunk boundaries moved forward to the next line start
+  std::vector<const char *> bounds(threads + 1);
+  bounds[0] = data;
+  for (unsigned i = 1; i < threads; i++) {
+    const char *p = data + size / threads * i;
+    if (p < bounds[i - 1]) p = bounds[i - 1];
+    const char *nl = findNewline(p, data + size);
+    bounds[i] = nl < data + size ? nl + 1 : data + size;
+  }
+  bounds[threads] = data + size;
+
+  std::vector<CsvChunk> chunks(threads);
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; i++) {
+    chunks[i].skipped_rows = 0;
+    workers.push_back(std::thread([&, i]() {
+      parseCsvChunk(bounds[i], bounds[i + 1], columns, options, chunks[i]);
+    }));
+  }
+  for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+  double parsed = nowSeconds();
+
+  // Timestamps become milliseconds since the first row
+  CsvFold fold;
+  initCsvFold(fold, chunks);
+  std::vector<StimulusRecord> stimulus;
+  unsigned long long rows = 0, skipped = 0;
+  for (unsigned i = 0; i < threads; i++) {
+    appendCsvStimulus(chunks[i], fold, stimulus);
+    rows += chunks[i].masks.size();
+    skipped += chunks[i].skipped_rows;
+  }
+  if (columns == CSV_OCCUPANCY_COLUMNS) rows -= skipped; // Held rows are not data
+
+  fprintf(stderr, "%llu rows (%llu skipped, %llu out of order or past 2^32 ms), %zu input "
+                  "changes, parsed %.1f MB in %.3f s (%.2f GB/s)\n",
+          rows, skipped, fold.rejected, stimulus.size(), size / 1e6,
+          parsed - start, parsed > start ? size / 1e9 / (parsed - start) : 0.0);
+
+  if (!writeTrace(argv[optind + 1], TRACE_STIMULUS, stimulus.data(), (uint32_t)stimulus.size())) {
+    return 1;
+  }
+  if (data) munmap((void *)data, size);
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include "csv_ingest.h"
+
+#include <string.h>
+
+#include "simd_scan.h"
+
+// Fixed-point parse of "12", "0.35", "87.5" into thousandths. Returns false
+// for anything that is not a plain decimal number.
+static bool parseMilli(const char *p, const char *end, long long &value) {
+  while (p < end && (*p == ' ' || *p == '"')) p++;
+  while (end > p && (end[-1] == ' ' || end[-1] == '"' || end[-1] == '\r')) end--;
+  if (p == end) return false;
+
+  long long whole = 0;
+  const char *digits = p;
+  while (p < end && *p >= '0' && *p <= '9') whole = whole * 10 + (*p++ - '0');
+  long long frac = 0;
+  int places = 0;
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && *p >= '0' && *p <= '9') {
+      if (places < 3) {
+        frac = frac * 10 + (*p - '0');
+        places++;
+      }
+      p++;
+    }
+  }
+  if (p != end || p == digits) return false;
+  while (places < 3) {
+    frac *= 10;
+    places++;
+  }
+  value = whole * 1000 + frac;
+  return true;
+}
+
+struct RowState {
+  int field;          // Index of the field being read
+  bool valid;
+  uint8_t mask;
+  long long time_ms;
+  const char *field_start;
+};
+
+static void endField(RowState &row, const char *field_end, int columns, const CsvOptions &options) {
+  long long value;
+  if (row.field >= columns || !parseMilli(row.field_start, field_end, value)) {
+    row.valid = false;
+  } else if (columns > CSV_OCCUPANCY_COLUMNS && row.field == 0) {
+    row.time_ms = value; // Seconds in thousandths are milliseconds
+  } else {
+    int column = row.field - (columns - CSV_OCCUPANCY_COLUMNS);
+    if (value > options.threshold_milli) row.mask |= CSV_COLUMN_BITS[column];
+  }
+  row.field++;
+}
+
+static void endRow(RowState &row, int columns, CsvChunk &out) {
+  bool blank = row.field == 1 && !row.valid;
+  if (row.valid && row.field == columns) {
+    out.masks.push_back(row.mask);
+    if (columns > CSV_OCCUPANCY_COLUMNS) out.times_ms.push_back(row.time_ms);
+  } else if (!blank) {
+    out.skipped_rows++;
+    // Without timestamps a row's time is its position, so keep its place
+    if (columns == CSV_OCCUPANCY_COLUMNS) out.masks.push_back(CSV_ROW_HELD);
+  }
+  row.field = 0;
+  row.valid = true;
+  row.mask = 0;
+  row.time_ms = 0;
+}
+
+void parseCsvChunk(const char *begin, const char *end, int columns, const CsvOptions &options,
+                   CsvChunk &out) {
+  size_t expected_rows = (end - begin) / 12;
+  out.masks.reserve(out.masks.size() + expected_rows);
+  if (columns > CSV_OCCUPANCY_COLUMNS) out.times_ms.reserve(out.times_ms.size() + expected_rows);
+  RowState row = { 0, true, 0, 0, begin };
+
+  // 64 bytes at a time: one bitmask of every ',' and '\n' in the block
+  const char *block = begin;
+  for (; block + 64 <= end; block += 64) {
+    uint64_t hits = matchMask64(block, ',', '\n');
+    while (hits) {
+      const char *d = block + __builtin_ctzll(hits);
+      hits &= hits - 1;
+      endField(row, d, columns, options);
+      row.field_start = d + 1;
+      if (*d == '\n') endRow(row, columns, out);
+    }
+  }
+  for (const char *d = block; d < end; d++) {
+    if (*d != ',' && *d != '\n') continue;
+    endField(row, d, columns, options);
+    row.field_start = d + 1;
+    if (*d == '\n') endRow(row, columns, out);
+  }
+
+  // Last line without a trailing newline
+  if (row.field_start < end) {
+    endField(row, end, columns, options);
+    endRow(row, columns, out);
+  }
+}
+
+int detectCsvColumns(const char *begin, const char *end) {
+  const char *p = begin;
+  while (p < end) {
+    const char *nl = findNewline(p, end);
+    int fields = 1;
+    bool numeric = true;
+    const char *field = p;
+    for (const char *q = p; q <= nl && q <= end; q++) {
+      if (q == nl || *q == ',') {
+        long long value;
+        if (!parseMilli(field, q, value)) numeric = false;
+        if (q != nl) fields++;
+        field = q + 1;
+      }
+    }
+    if (numeric && (fields == CSV_OCCUPANCY_COLUMNS || fields == CSV_OCCUPANCY_COLUMNS + 1)) {
+      return fields;
+    }
+    p = nl + 1;
+  }
+  return 0;
+}
+
+void initCsvFold(CsvFold &fold, const std::vector<CsvChunk> &chunks) {
+  fold.origin_ms = 0;
+  fold.last_ms = 0;
+  fold.last_mask = -1;
+  fold.rows = 0;
+  fold.rejected = 0;
+  unsigned long long row = 0;
+  for (size_t c = 0; c < chunks.size(); c++) {
+    const CsvChunk &chunk = chunks[c];
+    if (!chunk.times_ms.empty()) {
+      fold.origin_ms = chunk.times_ms[0];
+      return;
+    }
+    for (size_t i = 0; i < chunk.masks.size(); i++, row++) {
+      if (chunk.masks[i] != CSV_ROW_HELD) {
+        fold.origin_ms = (long long)row * 1000;
+        return;
+      }
+    }
+  }
+}
+
+void appendCsvStimulus(const CsvChunk &chunk, CsvFold &fold, std::vector<StimulusRecord> &out) {
+  bool timed = !chunk.times_ms.empty();
+  for (size_t i = 0; i < chunk.masks.size(); i++) {
+    long long t = timed ? chunk.times_ms[i] - fold.origin_ms
+                        : (long long)(fold.rows + i) * 1000 - fold.origin_ms;
+    uint8_t mask = chunk.masks[i];
+    if (mask == CSV_ROW_HELD) continue;
+    if (t < fold.last_ms || t > (long long)UINT32_MAX) {
+      fold.rejected++;
+      continue;
+    }
+    fold.last_ms = t;
+    if (mask == fold.last_mask) continue;
+    StimulusRecord r = { (uint32_t)t, mask, { 0, 0, 0 } };
+    out.push_back(r);
+    fold.last_mask = mask;
+  }
+  fold.rows += chunk.masks.size();
+}
@@ -0,0 +1,64 @@
+// Reader for detector vendor CSV exports.
+//
+// One row per second with occupancy columns NS1,NS2,EW1,EW2,EMERG, optionally
+// preceded by a timestamp column in (possibly fractional) epoch seconds.
+// Non-numeric rows such as a header are skipped. Values may be 0/1 flags,
+// fractions or percentages; a column counts as active when its value is
+// above the occupancy threshold.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "trace.h"
+
+const int CSV_OCCUPANCY_COLUMNS = 5;
+
+// Mask of a malformed row in an untimestamped file: it still takes up its
+// second, holding the previous row's inputs
+const uint8_t CSV_ROW_HELD = 0xFF;
+
+// Input bit for each occupancy column, in file order
+const uint8_t CSV_COLUMN_BITS[CSV_OCCUPANCY_COLUMNS] = {
+  IN_NS1, IN_NS2, IN_EW1, IN_EW2, IN_EMERGENCY
+};
+
+struct CsvOptions {
+  long threshold_milli;  // Active when value * 1000 > threshold_milli
+};
+
+// Parsed rows of one chunk
+struct CsvChunk {
+  std::vector<uint8_t> masks;        // IN_* mask or CSV_ROW_HELD per row
+  std::vector<long long> times_ms;   // Per row when the timestamp column is present
+  unsigned long long skipped_rows;   // Header or malformed rows
+};
+
+// State carried from chunk to chunk while folding rows into stimulus
+struct CsvFold {
+  long long origin_ms;               // Time of the first row
+  long long last_ms;                 // Time of the last row kept
+  int last_mask;                     // -1 before the first row
+  unsigned long long rows;           // Rows folded so far, CSV_ROW_HELD ones included
+  unsigned long long rejected;       // Timestamped rows before the origin, out of order or past 2^32 ms
+};
+
+// Parses whole lines in [begin, end); `begin` must be at the start of a line.
+// Every row must have `columns` fields (5, or 6 with a timestamp).
+void parseCsvChunk(const char *begin, const char *end, int columns, const CsvOptions &options,
+                   CsvChunk &out);
+
+// Field count of the first numeric row, or 0 if there is none
+int detectCsvColumns(const char *begin, const char *end);
+
+// Sets up `fold` for `chunks`: the origin is the first timestamp, or the
+// first well-formed row of an untimestamped file
+void initCsvFold(CsvFold &fold, const std::vector<CsvChunk> &chunks);
+
+// Appends a stimulus record for every row whose mask differs from the
+// previous one. Rows are one second apart unless they carry timestamps,
+// taken relative to the origin. Trace times must rise and fit in 32 bits,
+// so timestamped rows that go back in time or past 2^32 ms are dropped and
+// counted in `fold.rejected`.
+void appendCsvStimulus(const CsvChunk &chunk, CsvFold &fold, std::vector<StimulusRecord> &out);
@@ -0,0 +1,359 @@
+// traffic_daemon: runs the controller FSM for many virtual intersections.
+//
+// Cabinet clients connect to a UNIX-domain stream socket and send InputMsg
+// records; every input is answered with a StateMsg carrying the same seq, and
+// timer-driven transitions are pushed to the connection that last sent input
+// for that intersection. All sockets are multiplexed with one edge-triggered
+// epoll set. Reads drain the socket into a large buffer and replies are
+// queued per connection and flushed with one write() per epoll round.
+//
+// Every buffer is sized when the daemon starts or a connection is accepted,
+// so handling inputs and timers never allocates; the allocation counts per
+// phase are printed on exit. A client that falls OUT_CAPACITY replies
+// behind is disconnected rather than buffered without bound.
+//
+// Metrics (metrics.h) are recorded on the event loop and exported by a
+// separate thread: Prometheus text on http://127.0.0.1:<port>/metrics (-m)
+// and/or a file rewritten every -i seconds (-M) for a textfile collector.
+//
+// Usage: traffic_daemon [-n intersections] [-s socket_path] [-m metrics_port]
+//                       [-M metrics_file] [-i file_period_s]
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "alloc_count.h"
+#include "controller_bank.h"
+#include "metrics.h"
+#include "wire_protocol.h"
+
+const int MAX_EVENTS = 256;
+const size_t READ_CHUNK = 64 * 1024;
+const size_t OUT_CAPACITY = 16384; // Replies queued per connection
+const size_t MAX_CONNECTIONS = 4096;
+
+struct Connection {
+  bool open;
+  bool dirty;                 // Has queued output not yet flushed
+  size_t in_len;              // Bytes of a partial record carried over
+  unsigned char in_partial[sizeof(InputMsg)];
+  std::vector<StateMsg> out;  // Replies waiting for the next flush, reserved to OUT_CAPACITY
+  size_t out_sent;            // Bytes of `out` already written
+};
+
+// --- Daemon State ---
+ControllerBank bank;
+std::vector<int> owner_fd;           // Connection that receives timer transitions
+std::vector<Connection> connections; // Indexed by fd
+std::vector<int> dirty_fds;
+int epoll_fd = -1;
+
+// --- Statistics ---
+DaemonMetrics metrics;
+unsigned long long latency_sum_ns = 0;
+unsigned long long latency_max_ns = 0;
+
+static unsigned long long nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned long nowMs() {
+  return (unsigned long)(nowNs() / 1000000ULL);
+}
+
+static void closeConnection(int fd);
+
+static void queueState(int fd, int id, uint32_t seq) {
+  if (fd < 0 || !connections[fd].open) return;
+  Connection &conn = connections[fd];
+  if (conn.out.size() == OUT_CAPACITY) {
+    bumpCounter(metrics.slow_clients);
+    closeConnection(fd);
+    return;
+  }
+  StateMsg msg;
+  msg.intersection = (uint16_t)id;
+  msg.state = bank.state[id];
+  msg.lights = lightsForState((StateType)bank.state[id]);
+  msg.seq = seq;
+  conn.out.push_back(msg);
+  if (!conn.dirty) {
+    conn.dirty = true;
+    dirty_fds.push_back(fd);
+  }
+}
+
+static void closeConnection(int fd) {
+  Connection &conn = connections[fd];
+  if (!conn.open) return;
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+  close(fd);
+  conn.open = false;
+  conn.out.clear();
+  for (int i = 0; i < bank.count; i++) {
+    if (owner_fd[i] == fd) owner_fd[i] = -1;
+  }
+}
+
+// Writes as much queued output as the socket accepts
+static void flushConnection(int fd) {
+  Connection &conn = connections[fd];
+  conn.dirty = false;
+  if (!conn.open) return;
+
+  const char *data = (const char *)conn.out.data();
+  size_t total = conn.out.size() * sizeof(StateMsg);
+  while (conn.out_sent < total) {
+    ssize_t n = write(fd, data + conn.out_sent, total - conn.out_sent);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break; // EPOLLOUT resumes
+      if (errno == EINTR) continue;
+      closeConnection(fd);
+      return;
+    }
+    conn.out_sent += n;
+  }
+  if (conn.out_sent == total) {
+    conn.out.clear();
+    conn.out_sent = 0;
+  }
+}
+
+static void handleInput(int fd, const InputMsg &msg, unsigned long now) {
+  // A full reply ring closes the connection mid-batch; its fd may be reused
+  if (!connections[fd].open || msg.intersection >= bank.count) return;
+  int id = msg.intersection;
+  owner_fd[id] = fd;
+  uint8_t from = bank.state[id];
+  unsigned long from_start = bank.start_ms[id];
+  metricsInput(metrics, id, msg.inputs, now);
+  if (applyBankInputs(bank, id, msg.inputs, now)) {
+    metricsTransition(metrics, id, from, from_start, bank.state[id], now);
+  }
+  queueState(fd, id, msg.seq);
+}
+
+// Drains the socket and handles every complete record
+static void readConnection(int fd, std::vector<unsigned char> &buffer) {
+  Connection &conn = connections[fd];
+  while (conn.open) {
+    memcpy(buffer.data(), conn.in_partial, conn.in_len);
+    ssize_t n = read(fd, buffer.data() + conn.in_len, READ_CHUNK);
+    if (n == 0) {
+      closeConnection(fd);
+      return;
+    }
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) closeConnection(fd);
+      return;
+    }
+
+    unsigned long long received = nowNs();
+    unsigned long now = (unsigned long)(received / 1000000ULL);
+    size_t len = conn.in_len + n;
+    size_t records = len / sizeof(InputMsg);
+    for (size_t i = 0; i < records && conn.open; i++) {
+      InputMsg msg;
+      memcpy(&msg, buffer.data() + i * sizeof(InputMsg), sizeof(msg));
+      handleInput(fd, msg, now);
+    }
+    if (!conn.open) return;
+    conn.in_len = len - records * sizeof(InputMsg);
+    memcpy(conn.in_partial, buffer.data() + records * sizeof(InputMsg), conn.in_len);
+
+    // Latency is measured from the read returning to the decision being queued
+    unsigned long long latency = nowNs() - received;
+    latency_sum_ns += latency * records;
+    if (latency > latency_max_ns) latency_max_ns = latency;
+    if (records > 0) observeHistogram(metrics.batch_latency, latency / 1000);
+  }
+}
+
+static void acceptConnections(int listen_fd) {
+  // Accepting sizes the connection's buffers; that is setup, not stepping
+  allocSetPhase(ALLOC_PHASE_SETUP);
+  while (true) {
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) break;
+    if ((size_t)fd >= MAX_CONNECTIONS) {
+      close(fd);
+      continue;
+    }
+    Connection &conn = connections[fd];
+    conn.open = true;
+    conn.dirty = false;
+    conn.in_len = 0;
+    conn.out.clear();
+    conn.out.reserve(OUT_CAPACITY);
+    conn.out_sent = 0;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
+    ev.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+  }
+  allocSetPhase(ALLOC_PHASE_STEADY);
+}
+
+// Steps every controller whose timer has expired
+static void runTimers(unsigned long now) {
+  for (int i = 0; i < bank.count; i++) {
+    if (bank.deadline_ms[i] > now) continue;
+    uint8_t from = bank.state[i];
+    unsigned long from_start = bank.start_ms[i];
+    if (stepBank(bank, i, now)) {
+      metricsTransition(metrics, i, from, from_start, bank.state[i], now);
+      queueState(owner_fd[i], i, 0);
+    }
+  }
+}
+
+static int openListenSocket(const char *path) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int main(int argc, char **argv) {
+  int count = 256;
+  const char *path = DEFAULT_DAEMON_SOCKET;
+  int metrics_port = 0;
+  const char *metrics_file = NULL;
+  int metrics_period_s = 15;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:s:m:M:i:")) != -1) {
+    switch (opt) {
+      case 'n': count = atoi(optarg); break;
+      case 's': path = optarg; break;
+      case 'm': metrics_port = atoi(optarg); break;
+      case 'M': metrics_file = optarg; break;
+      case 'i': metrics_period_s = atoi(optarg); break;
+      default:
+        fprintf(stderr, "Usage: %s [-n intersections] [-s socket_path] [-m metrics_port] "
+                        "[-M metrics_file] [-i file_period_s]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (count < 1 || count > 65536) {
+    fprintf(stderr, "Intersection count must be 1..65536\n");
+    return 1;
+  }
+
+  initBank(bank, count, DEFAULT_TIMING, nowMs());
+  initMetrics(metrics, count, nowMs());
+  owner_fd.assign(count, -1);
+  connections.resize(MAX_CONNECTIONS);
+  dirty_fds.reserve(MAX_CONNECTIONS);
+
+  int listen_fd = openListenSocket(path);
+  if (listen_fd < 0) {
+    perror("listen");
+    return 1;
+  }
+
+  // SIGINT/SIGTERM arrive through epoll so shutdown never races a handler
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+  signal(SIGPIPE, SIG_IGN);
+  int signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = listen_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+  ev.data.fd = signal_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev);
+
+  if (!startMetricsExporter(metrics, metrics_port, metrics_file, metrics_period_s)) return 1;
+
+  printf("traffic_daemon: %d intersections on %s\n", count, path);
+  fflush(stdout);
+
+  std::vector<unsigned char> buffer(READ_CHUNK + sizeof(InputMsg));
+  struct epoll_event events[MAX_EVENTS];
+  bool running = true;
+  allocSetPhase(ALLOC_PHASE_STEADY);
+  while (running) {
+    // Sleep until the next controller timer is due
+    unsigned long now = nowMs();
+    unsigned long deadline = earliestDeadline(bank);
+    int timeout = -1;
+    if (deadline != NO_DEADLINE) {
+      timeout = deadline > now ? (int)(deadline - now) : 0;
+    }
+
+    int n = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+    if (deadline != NO_DEADLINE) {
+      // How late the loop got round to timers that were due
+      unsigned long long woke = nowNs();
+      unsigned long long due = (unsigned long long)deadline * 1000000ULL;
+      if (woke >= due) observeHistogram(metrics.timer_lateness, (woke - due) / 1000);
+    }
+    for (int i = 0; i < n; i++) {
+      int fd = events[i].data.fd;
+      if (fd == listen_fd) {
+        acceptConnections(listen_fd);
+      } else if (fd == signal_fd) {
+        running = false;
+      } else {
+        if (events[i].events & EPOLLIN) readConnection(fd, buffer);
+        if ((events[i].events & EPOLLOUT) && connections[fd].open &&
+            !connections[fd].out.empty() && !connections[fd].dirty) {
+          connections[fd].dirty = true;
+          dirty_fds.push_back(fd);
+        }
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) closeConnection(fd);
+      }
+    }
+
+    runTimers(nowMs());
+
+    for (size_t i = 0; i < dirty_fds.size(); i++) {
+      flushConnection(dirty_fds[i]);
+    }
+    dirty_fds.clear();
+  }
+
+  unsigned long long inputs_handled = metrics.inputs.load();
+  printf("traffic_daemon: %llu inputs, %llu transitions", inputs_handled,
+         (unsigned long long)metrics.transitions.load());
+  if (inputs_handled > 0) {
+    printf(", batch latency avg %llu ns max %llu ns", latency_sum_ns / inputs_handled,
+           latency_max_ns);
+  }
+  printf("\n");
+  AllocCounters steady = allocCounters(ALLOC_PHASE_STEADY);
+  allocSetPhase(ALLOC_PHASE_SETUP);
+  stopMetricsExporter();
+  printf("traffic_daemon: %llu allocations while serving, %llu slow clients dropped\n",
+         steady.allocs, (unsigned long long)metrics.slow_clients.load());
+  unlink(path);
+  return 0;
+}
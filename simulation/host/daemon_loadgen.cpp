@@ -0,0 +1,128 @@
+// daemon_loadgen: drives traffic_daemon with random detector inputs.
+//
+// Opens one connection per simulated cabinet gateway, each owning a slice of
+// the intersections, and sends bursts of InputMsg records. Round-trip time
+// from send to the matching StateMsg is reported as a latency percentile.
+//
+// Usage: daemon_loadgen [-n intersections] [-c connections] [-r rounds] [-s socket_path]
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "controller.h"
+#include "wire_protocol.h"
+
+static unsigned long long nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int connectTo(const char *path) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Reads replies until the one answering `seq` arrives; timer pushes are skipped
+static bool awaitReply(int fd, uint32_t seq, std::vector<StateMsg> &buffer, size_t &have) {
+  while (true) {
+    for (size_t i = 0; i < have; i++) {
+      if (buffer[i].seq == seq) {
+        have = 0;
+        return true;
+      }
+    }
+    have = 0;
+    ssize_t n = read(fd, buffer.data(), buffer.size() * sizeof(StateMsg));
+    if (n <= 0) return false;
+    have = n / sizeof(StateMsg); // Daemon always writes whole records
+  }
+}
+
+int main(int argc, char **argv) {
+  int count = 256;
+  int conns = 8;
+  int rounds = 1000;
+  const char *path = DEFAULT_DAEMON_SOCKET;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:c:r:s:")) != -1) {
+    switch (opt) {
+      case 'n': count = atoi(optarg); break;
+      case 'c': conns = atoi(optarg); break;
+      case 'r': rounds = atoi(optarg); break;
+      case 's': path = optarg; break;
+      default:
+        fprintf(stderr, "Usage: %s [-n intersections] [-c connections] [-r rounds] [-s socket_path]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (conns < 1 || conns > count) conns = count;
+
+  std::vector<int> fds(conns);
+  for (int c = 0; c < conns; c++) {
+    fds[c] = connectTo(path);
+    if (fds[c] < 0) {
+      perror("connect");
+      return 1;
+    }
+  }
+
+  srand(1);
+  std::vector<InputMsg> burst;
+  std::vector<StateMsg> replies(4096);
+  std::vector<unsigned long long> latencies;
+  latencies.reserve((size_t)rounds * conns);
+  uint32_t seq = 1;
+  unsigned long long start = nowNs();
+  for (int r = 0; r < rounds; r++) {
+    for (int c = 0; c < conns; c++) {
+      // One record per intersection owned by this connection, in a single write
+      burst.clear();
+      for (int id = c; id < count; id += conns) {
+        InputMsg msg;
+        msg.intersection = (uint16_t)id;
+        msg.inputs = (uint8_t)(rand() & (IN_NS_ANY | IN_EW_ANY));
+        if (rand() % 500 == 0) msg.inputs |= IN_EMERGENCY;
+        msg.reserved = 0;
+        msg.seq = seq++;
+        burst.push_back(msg);
+      }
+      unsigned long long sent = nowNs();
+      if (write(fds[c], burst.data(), burst.size() * sizeof(InputMsg)) < 0) {
+        perror("write");
+        return 1;
+      }
+      size_t have = 0;
+      if (!awaitReply(fds[c], burst.back().seq, replies, have)) {
+        fprintf(stderr, "daemon closed the connection\n");
+        return 1;
+      }
+      latencies.push_back(nowNs() - sent);
+    }
+  }
+  double seconds = (nowNs() - start) / 1e9;
+
+  std::sort(latencies.begin(), latencies.end());
+  size_t n = latencies.size();
+  printf("%u inputs in %.3f s (%.0f inputs/s)\n", seq - 1, seconds, (seq - 1) / seconds);
+  printf("burst round trip: p50 %llu us, p99 %llu us, max %llu us\n",
+         latencies[n / 2] / 1000, latencies[n * 99 / 100] / 1000, latencies[n - 1] / 1000);
+
+  for (int c = 0; c < conns; c++) close(fds[c]);
+  return 0;
+}
@@ -0,0 +1,59 @@
+// Fixed-capacity ring buffer for logs and queues on the stepping path.
+//
+// All storage is allocated by init(); push() never grows the buffer. When
+// full, push() refuses the item and pushOverwrite() replaces the oldest one,
+// and either way the loss is counted.
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+template <typename T>
+struct FixedRing {
+  std::vector<T> slots;
+  size_t head;                // Index of the oldest item
+  size_t count;
+  unsigned long long dropped; // Items refused or overwritten
+
+  void init(size_t capacity) {
+    slots.assign(capacity, T());
+    head = 0;
+    count = 0;
+    dropped = 0;
+  }
+
+  size_t capacity() const { return slots.size(); }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  bool full() const { return count == slots.size(); }
+
+  bool push(const T &item) {
+    if (full()) {
+      dropped++;
+      return false;
+    }
+    slots[(head + count) % slots.size()] = item;
+    count++;
+    return true;
+  }
+
+  void pushOverwrite(const T &item) {
+    if (full()) {
+      dropped++;
+      head = (head + 1) % slots.size();
+      count--;
+    }
+    push(item);
+  }
+
+  // Oldest item; the ring must not be empty
+  const T &front() const { return slots[head]; }
+
+  void pop() {
+    head = (head + 1) % slots.size();
+    count--;
+  }
+
+  // i-th oldest item
+  const T &at(size_t i) const { return slots[(head + i) % slots.size()]; }
+};
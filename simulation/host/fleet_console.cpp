@@ -0,0 +1,220 @@
+// fleet_console: runs serial console commands on many controllers at once.
+//
+// Each device is a board's serial port or a pty_device pseudo-terminal. Every
+// command (-c, repeatable, or one per line of a -f script) is sent to all
+// devices together, and the next one follows once every device has answered.
+// Reply lines ("> ..." from the sketch's console) are printed prefixed with
+// the device path, grouped by device in command-line order, so the output can
+// be fed straight to grep or awk:
+//
+//   /tmp/ttyTLC1 state=NS_GREEN elapsed_ms=4210
+//   /tmp/ttyTLC1 ok
+//
+// Transition log lines between replies are skipped. A device that answers
+// "error" or stays silent for -t ms is reported; silent devices get no
+// further commands. Exits non-zero if any command failed anywhere.
+//
+// Usage: fleet_console [-b baud] [-t timeout_ms] [-f script] [-c command]... device...
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+const size_t LINE_MAX_BYTES = 256;
+
+struct Device {
+  const char *path;
+  int fd;
+  char line[LINE_MAX_BYTES];
+  size_t len;
+  std::string reply;  // Reply lines so far, printed once every device answered
+  bool answered;      // Current command's reply is complete
+  bool silent;        // Timed out once; skipped from then on
+};
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void configureSerial(int fd, unsigned long baud) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0) return; // Not a terminal
+  cfmakeraw(&tio);
+  speed_t speed = B9600;
+  switch (baud) {
+    case 19200: speed = B19200; break;
+    case 38400: speed = B38400; break;
+    case 57600: speed = B57600; break;
+    case 115200: speed = B115200; break;
+    case 230400: speed = B230400; break;
+    default: break;
+  }
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  tcsetattr(fd, TCSANOW, &tio);
+  tcflush(fd, TCIFLUSH); // Drop whatever arrived before we asked
+}
+
+// Handles one received line. Returns true when it ends the reply.
+static bool handleLine(Device &d, char *line, bool &failed) {
+  size_t len = strlen(line);
+  if (len > 0 && line[len - 1] == '\r') line[--len] = '\0';
+  if (strncmp(line, "> ", 2) != 0) return false; // Transition log, not a reply
+  const char *reply = line + 2;
+  d.reply += d.path;
+  d.reply += ' ';
+  d.reply += reply;
+  d.reply += '\n';
+  if (strcmp(reply, "ok") == 0) return true;
+  if (strncmp(reply, "error", 5) == 0) {
+    failed = true;
+    return true;
+  }
+  return false;
+}
+
+static void readDevice(Device &d, bool &failed) {
+  char data[512];
+  ssize_t n = read(d.fd, data, sizeof(data));
+  if (n <= 0) return;
+  for (ssize_t i = 0; i < n && !d.answered; i++) {
+    if (data[i] != '\n') {
+      // Overlong lines are cut; replies are far shorter
+      if (d.len < LINE_MAX_BYTES - 1) d.line[d.len++] = data[i];
+      continue;
+    }
+    d.line[d.len] = '\0';
+    d.len = 0;
+    d.answered = handleLine(d, d.line, failed);
+  }
+}
+
+// Sends `command` to every responsive device and waits for all replies
+static bool runCommand(std::vector<Device> &devices, const std::string &command,
+                       double timeout_s) {
+  bool failed = false;
+  std::string text = command + "\n";
+  for (size_t i = 0; i < devices.size(); i++) {
+    Device &d = devices[i];
+    d.answered = d.silent;
+    d.len = 0;
+    d.reply.clear();
+    if (d.silent) continue;
+    if (write(d.fd, text.data(), text.size()) != (ssize_t)text.size()) {
+      fprintf(stderr, "%s: %s\n", d.path, strerror(errno));
+      d.answered = d.silent = true;
+      failed = true;
+    }
+  }
+
+  double deadline = nowSeconds() + timeout_s;
+  std::vector<struct pollfd> fds;
+  std::vector<size_t> owner;
+  while (true) {
+    fds.clear();
+    owner.clear();
+    for (size_t i = 0; i < devices.size(); i++) {
+      if (devices[i].answered) continue;
+      struct pollfd p = { devices[i].fd, POLLIN, 0 };
+      fds.push_back(p);
+      owner.push_back(i);
+    }
+    if (fds.empty()) break;
+
+    int wait_ms = (int)((deadline - nowSeconds()) * 1000);
+    if (wait_ms <= 0) {
+      for (size_t k = 0; k < owner.size(); k++) {
+        Device &d = devices[owner[k]];
+        d.reply += d.path;
+        d.reply += " timeout\n";
+        d.silent = true;
+      }
+      failed = true;
+      break;
+    }
+    if (poll(fds.data(), fds.size(), wait_ms) < 0 && errno != EINTR) {
+      perror("poll");
+      return false;
+    }
+    for (size_t k = 0; k < fds.size(); k++) {
+      if (fds[k].revents & (POLLIN | POLLHUP | POLLERR)) readDevice(devices[owner[k]], failed);
+    }
+  }
+  for (size_t i = 0; i < devices.size(); i++) fputs(devices[i].reply.c_str(), stdout);
+  fflush(stdout);
+  return !failed;
+}
+
+int main(int argc, char **argv) {
+  unsigned long baud = 9600;
+  double timeout_s = 2.0;
+  std::vector<std::string> commands;
+  int opt;
+  while ((opt = getopt(argc, argv, "b:t:f:c:")) != -1) {
+    switch (opt) {
+      case 'b': baud = strtoul(optarg, NULL, 10); break;
+      case 't': timeout_s = atof(optarg) / 1000.0; break;
+      case 'c': commands.push_back(optarg); break;
+      case 'f': {
+        FILE *f = fopen(optarg, "r");
+        if (!f) {
+          perror(optarg);
+          return 1;
+        }
+        char line[LINE_MAX_BYTES];
+        while (fgets(line, sizeof(line), f)) {
+          line[strcspn(line, "\r\n")] = '\0';
+          if (line[0] != '\0' && line[0] != '#') commands.push_back(line);
+        }
+        fclose(f);
+        break;
+      }
+      default:
+        optind = argc + 1;
+        break;
+    }
+  }
+  if (optind >= argc || commands.empty()) {
+    fprintf(stderr, "Usage: %s [-b baud] [-t timeout_ms] [-f script] [-c command]... device...\n",
+            argv[0]);
+    return 1;
+  }
+
+  std::vector<Device> devices;
+  for (int i = optind; i < argc; i++) {
+    for (int j = optind; j < i; j++) {
+      if (strcmp(argv[i], argv[j]) == 0) {
+        fprintf(stderr, "%s listed twice\n", argv[i]);
+        return 1;
+      }
+    }
+    Device d;
+    d.path = argv[i];
+    d.len = 0;
+    d.answered = d.silent = false;
+    d.fd = open(argv[i], O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (d.fd < 0) {
+      perror(argv[i]);
+      return 1;
+    }
+    configureSerial(d.fd, baud);
+    devices.push_back(d);
+  }
+
+  bool ok = true;
+  for (size_t c = 0; c < commands.size(); c++) {
+    if (!runCommand(devices, commands[c], timeout_s)) ok = false;
+  }
+  for (size_t i = 0; i < devices.size(); i++) close(devices[i].fd);
+  return ok ? 0 : 1;
+}
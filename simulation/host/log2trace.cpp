@@ -0,0 +1,229 @@
+// log2trace: converts archived Serial logs into replay traces.
+//
+// The log is mapped read-only and split at line boundaries into one chunk per
+// thread; each chunk is scanned with the SIMD newline finder and only lines
+// long enough to be a transition are parsed. The transition stream is written
+// as a TRACE_TRANSITIONS file, and optionally the stimulus that reproduces it
+// (-s). With -c the inferred stimulus is run back through the controller and
+// compared with the log, restarting at each reset and skipping what follows a
+// "Telemetry dropped" gap until the next one.
+//
+// Usage: log2trace [-j threads] [-s stimulus.tlct] [-c] [-t tolerance_ms] input.log transitions.tlct
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "log_parser.h"
+#include "simd_scan.h"
+#include "trace.h"
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct BackTestStats {
+  size_t compared;
+  size_t simulated;
+  size_t state_mismatch;
+  size_t late;
+  size_t skipped;       // After a telemetry gap, until the next reset
+  long max_skew;
+};
+
+// Runs the controller from INIT, no earlier than `start`, over one segment's
+// inferred stimulus and compares its transitions with the segment's, in order
+static void backTestSegment(const std::vector<TransitionRecord> &segment, unsigned long start,
+                            unsigned long tolerance_ms, BackTestStats &stats) {
+  if (segment.empty()) return;
+  // Start late enough for INIT -> NS_GREEN to land on its stamp; a reset may
+  // have been held for a while before it
+  const TransitionRecord &first = segment[0];
+  if (first.from == INIT && first.to == NS_GREEN && first.t_ms >= start + DEFAULT_TIMING.init_ms) {
+    start = first.t_ms - DEFAULT_TIMING.init_ms;
+  }
+  std::vector<StimulusRecord> stimulus;
+  inferStimulus(segment, DEFAULT_TIMING, stimulus);
+  unsigned long end = segment.back().t_ms + tolerance_ms + 1;
+
+  std::vector<TransitionRecord> simulated;
+  simulateStimulus(stimulus.data(), stimulus.size(), start, end, DEFAULT_TIMING, simulated);
+  stats.simulated += simulated.size();
+
+  size_t n = segment.size() < simulated.size() ? segment.size() : simulated.size();
+  stats.compared += n;
+  for (size_t i = 0; i < n; i++) {
+    if (segment[i].from != simulated[i].from || segment[i].to != simulated[i].to) {
+      if (stats.state_mismatch++ == 0) {
+        fprintf(stderr, "first mismatch at %u ms: log %s -> %s, controller %s -> %s\n",
+                segment[i].t_ms, stateName((StateType)segment[i].from),
+                stateName((StateType)segment[i].to), stateName((StateType)simulated[i].from),
+                stateName((StateType)simulated[i].to));
+      }
+      continue;
+    }
+    long skew = (long)simulated[i].t_ms - (long)segment[i].t_ms;
+    if (skew < 0) skew = -skew;
+    if (skew > stats.max_skew) stats.max_skew = skew;
+    if ((unsigned long)skew > tolerance_ms) stats.late++;
+  }
+}
+
+// Compares the controller's transitions with the log's. Each reset starts a
+// new segment from INIT, so an inferred time that is off cannot shift the
+// rest of the log; records after a telemetry gap are skipped until the next
+// reset, as the controller's state there is unknown.
+static void backTest(const std::vector<TransitionRecord> &logged, unsigned long tolerance_ms) {
+  BackTestStats stats = BackTestStats();
+  std::vector<TransitionRecord> segment;
+  bool skipping = false;
+
+  // A log that starts mid-cycle cannot match; start it where it starts
+  unsigned long start = 0;
+  if (!logged.empty() && logged[0].from != INIT) start = logged[0].t_ms;
+
+  for (size_t i = 0; i < logged.size(); i++) {
+    const TransitionRecord &r = logged[i];
+    if (r.flags & TRANSITION_RESET) {
+      backTestSegment(segment, start, tolerance_ms, stats);
+      segment.clear();
+      skipping = false;
+      start = r.t_ms;
+      continue;
+    }
+    if (r.flags & TRANSITION_AFTER_GAP) {
+      backTestSegment(segment, start, tolerance_ms, stats);
+      segment.clear();
+      skipping = true;
+    }
+    if (skipping) {
+      stats.skipped++;
+      continue;
+    }
+    segment.push_back(r);
+  }
+  backTestSegment(segment, start, tolerance_ms, stats);
+
+  printf("back-test: %zu logged, %zu compared, %zu simulated, %zu state mismatches, "
+         "%zu beyond %lu ms, max skew %ld ms, %zu skipped after gaps\n",
+         logged.size(), stats.compared, stats.simulated, stats.state_mismatch, stats.late,
+         tolerance_ms, stats.max_skew, stats.skipped);
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = std::thread::hardware_concurrency();
+  const char *stimulus_path = NULL;
+  bool check = false;
+  unsigned long tolerance_ms = 50;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:s:ct:")) != -1) {
+    switch (opt) {
+      case 'j': threads = atoi(optarg); break;
+      case 's': stimulus_path = optarg; break;
+      case 'c': check = true; break;
+      case 't': tolerance_ms = strtoul(optarg, NULL, 10); break;
+      default:
+        optind = argc + 1;
+        break;
+    }
+  }
+  if (optind + 2 != argc) {
+    fprintf(stderr, "Usage: %s [-j threads] [-s stimulus.tlct] [-c] [-t tolerance_ms] "
+                    "input.log transitions.tlct\n", argv[0]);
+    return 1;
+  }
+  if (threads == 0) threads = 1;
+
+  int fd = open(argv[optind], O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    perror(argv[optind]);
+    return 1;
+  }
+  size_t size = st.st_size;
+  const char *data = NULL;
+  if (size > 0) {
+    data = (const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (data == MAP_FAILED) {
+      perror("mmap");
+      return 1;
+    }
+    madvise((void *)data, size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  double start = nowSeconds();
+
+  // Chunk boundaries moved forward to the next line start
+  std::vector<const char *> bounds(threads + 1);
+  bounds[0] = data;
+  for (unsigned i = 1; i < threads; i++) {
+    const char *p = data + size / threads * i;
+    if (p < bounds[i - 1]) p = bounds[i - 1];
+    const char *nl = findNewline(p, data + size);
+    bounds[i] = nl < data + size ? nl + 1 : data + size;
+  }
+  bounds[threads] = data + size;
+
+  std::vector<std::vector<LogEvent> > events(threads);
+  std::vector<LogParseStats> stats(threads, LogParseStats());
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; i++) {
+    workers.push_back(std::thread([&, i]() {
+      events[i].reserve((bounds[i + 1] - bounds[i]) / 32);
+      parseLogChunk(bounds[i], bounds[i + 1], events[i], stats[i]);
+    }));
+  }
+  for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+
+  std::vector<LogEvent> all;
+  LogParseStats total = LogParseStats();
+  for (unsigned i = 0; i < threads; i++) {
+    all.insert(all.end(), events[i].begin(), events[i].end());
+    total.lines += stats[i].lines;
+    total.gaps += stats[i].gaps;
+    total.dropped += stats[i].dropped;
+  }
+  double parsed = nowSeconds();
+
+  std::vector<TransitionRecord> transitions;
+  transitions.reserve(all.size());
+  if (!assembleTransitions(all, DEFAULT_TIMING, transitions)) {
+    fprintf(stderr, "%s runs past 2^32 ms (49.7 days); split it and convert each part\n",
+            argv[optind]);
+    return 1;
+  }
+
+  fprintf(stderr, "%llu lines, %zu transitions, parsed %.1f MB in %.3f s (%.2f GB/s)\n",
+          total.lines, transitions.size(), size / 1e6, parsed - start,
+          parsed > start ? size / 1e9 / (parsed - start) : 0.0);
+  if (total.gaps > 0) {
+    fprintf(stderr, "warning: %llu telemetry gaps (%llu records dropped); transitions after "
+                    "each are flagged and the stimulus across them is approximate\n",
+            total.gaps, total.dropped);
+  }
+
+  if (!writeTrace(argv[optind + 1], TRACE_TRANSITIONS, transitions.data(),
+                  (uint32_t)transitions.size())) {
+    return 1;
+  }
+  if (stimulus_path) {
+    std::vector<StimulusRecord> stimulus;
+    inferStimulus(transitions, DEFAULT_TIMING, stimulus);
+    if (!writeTrace(stimulus_path, TRACE_STIMULUS, stimulus.data(), (uint32_t)stimulus.size())) {
+      return 1;
+    }
+  }
+  if (check) backTest(transitions, tolerance_ms);
+
+  if (data) munmap((void *)data, size);
+  return 0;
+}
@@ -0,0 +1,293 @@
+#include "log_parser.h"
+
+#include <string.h>
+
+#include "simd_scan.h"
+
+const uint32_t DAY_MS = 24UL * 60 * 60 * 1000;
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+static unsigned twoDigits(const char *p) { return (p[0] - '0') * 10 + (p[1] - '0'); }
+
+// Consumes a timestamp prefix if present
+static const char *parseTimestamp(const char *p, const char *end, uint32_t &time_ms,
+                                  bool &has_time) {
+  has_time = false;
+
+  // "HH:MM:SS.mmm -> "
+  if (end - p >= 16 && p[2] == ':' && p[5] == ':' && p[8] == '.' && isDigit(p[0]) &&
+      isDigit(p[1]) && isDigit(p[3]) && isDigit(p[4]) && isDigit(p[6]) && isDigit(p[7]) &&
+      isDigit(p[9]) && isDigit(p[10]) && isDigit(p[11]) && memcmp(p + 12, " -> ", 4) == 0) {
+    time_ms = ((twoDigits(p) * 60 + twoDigits(p + 3)) * 60 + twoDigits(p + 6)) * 1000 +
+              (p[9] - '0') * 100 + twoDigits(p + 10);
+    has_time = true;
+    return p + 16;
+  }
+
+  // "12345 " or "[12345] "
+  const char *q = p;
+  if (q < end && *q == '[') q++;
+  const char *digits = q;
+  uint32_t value = 0;
+  while (q < end && isDigit(*q)) value = value * 10 + (*q++ - '0');
+  if (q == digits) return p;
+  if (q < end && *q == ']') q++;
+  if (q < end && (*q == ' ' || *q == ':')) {
+    while (q < end && (*q == ' ' || *q == ':')) q++;
+    time_ms = value;
+    has_time = true;
+    return q;
+  }
+  return p;
+}
+
+// Matches a state name exactly filling [p, end)
+static bool parseStateName(const char *p, const char *end, uint8_t &state) {
+  size_t len = end - p;
+  switch (len) {
+    case 4:
+      state = INIT;
+      return memcmp(p, "INIT", 4) == 0;
+    case 8:
+    case 9:
+      if (memcmp(p, "NS", 2) == 0) {
+        state = len == 8 ? NS_GREEN : NS_YELLOW;
+      } else if (memcmp(p, "EW", 2) == 0) {
+        state = len == 8 ? EW_GREEN : EW_YELLOW;
+      } else {
+        return false;
+      }
+      return memcmp(p + 2, len == 8 ? "_GREEN" : "_YELLOW", len - 2) == 0;
+    case 15:
+      if (memcmp(p, "EMERGENCY_", 10) != 0) return false;
+      if (memcmp(p + 10, "TRANS", 5) == 0) {
+        state = EMERGENCY_TRANS;
+        return true;
+      }
+      state = EMERGENCY_GREEN;
+      return memcmp(p + 10, "GREEN", 5) == 0;
+    default:
+      return false;
+  }
+}
+
+static bool parseLine(const char *p, const char *end, LogEvent &event) {
+  while (end > p && (end[-1] == '\r' || end[-1] == ' ')) end--;
+  bool has_time;
+  p = parseTimestamp(p, end, event.time_ms, has_time);
+  event.has_time = has_time;
+  if (!has_time) event.time_ms = 0;
+
+  if (end - p > 14 && memcmp(p, "State Change: ", 14) == 0) {
+    p += 14;
+    const char *arrow = (const char *)memchr(p, '-', end - p);
+    if (!arrow || arrow == p || arrow[-1] != ' ' || end - arrow < 3 || arrow[1] != '>' ||
+        arrow[2] != ' ') {
+      return false;
+    }
+    event.kind = LOG_TRANSITION;
+    return parseStateName(p, arrow - 1, event.from) && parseStateName(arrow + 3, end, event.to);
+  }
+  if (end - p == 16 && memcmp(p, "RESET Activated!", 16) == 0) {
+    event.kind = LOG_RESET;
+    event.from = event.to = INIT;
+    return true;
+  }
+  if (end - p > 19 && memcmp(p, "Telemetry dropped: ", 19) == 0) {
+    event.kind = LOG_GAP;
+    event.from = event.to = INIT;
+    return true;
+  }
+  return false;
+}
+
+// Record count of a "Telemetry dropped: N records" line
+static unsigned long droppedCount(const char *p, const char *end) {
+  const char *q = (const char *)memchr(p, ':', end - p);
+  unsigned long n = 0;
+  if (!q) return 0;
+  for (q++; q < end && *q == ' '; q++) {
+  }
+  while (q < end && isDigit(*q)) n = n * 10 + (*q++ - '0');
+  return n;
+}
+
+void parseLogChunk(const char *begin, const char *end, std::vector<LogEvent> &out,
+                   LogParseStats &stats) {
+  const char *p = begin;
+  while (p < end) {
+    const char *nl = findNewline(p, end);
+    // Every recognized line is at least "RESET Activated!" long
+    if (nl - p >= 16) {
+      LogEvent event;
+      if (parseLine(p, nl, event)) {
+        out.push_back(event);
+        if (event.kind == LOG_GAP) {
+          stats.gaps++;
+          stats.dropped += droppedCount(p, nl);
+        } else {
+          stats.events++;
+        }
+      }
+    }
+    stats.lines++;
+    p = nl + 1;
+  }
+}
+
+// Least time the FSM can spend in `from` before moving to `to`
+static unsigned long minimumDwell(uint8_t from, uint8_t to, bool emergency,
+                                  const TimingPlan &plan) {
+  if (emergency) {
+    if (from == EW_YELLOW) return plan.yellow_ms;
+    if (from == EMERGENCY_TRANS && to == EMERGENCY_GREEN) return plan.emergency_wait_ms;
+    return 0;
+  }
+  switch (from) {
+    case INIT: return plan.init_ms;
+    case NS_GREEN: return plan.ns_green_ms;
+    case NS_YELLOW: return plan.yellow_ms;
+    case EW_GREEN: return plan.ew_green_ms;
+    case EW_YELLOW: return plan.yellow_ms;
+    default: return 0;
+  }
+}
+
+// True when transition i can only have been caused by the emergency input
+static bool emergencyCaused(const std::vector<LogEvent> &events, size_t i) {
+  uint8_t to = events[i].to;
+  if (events[i].kind != LOG_TRANSITION) return false;
+  if (to == EMERGENCY_TRANS || to == EMERGENCY_GREEN) return true;
+  if (events[i].from == EW_GREEN && to == EW_YELLOW) {
+    // The next transition tells an emergency yellow from a normal one
+    if (i + 1 < events.size()) {
+      const LogEvent &next = events[i + 1];
+      return next.kind == LOG_TRANSITION && next.from == EW_YELLOW && next.to == EMERGENCY_TRANS;
+    }
+  }
+  return false;
+}
+
+bool assembleTransitions(const std::vector<LogEvent> &events, const TimingPlan &plan,
+                         std::vector<TransitionRecord> &out) {
+  uint8_t state = INIT;
+  uint32_t last_raw = 0;
+  uint64_t day_offset = 0;
+  uint64_t t = 0;
+  bool have_time = false;
+  bool after_gap = false;
+
+  for (size_t i = 0; i < events.size(); i++) {
+    const LogEvent &e = events[i];
+    if (e.kind == LOG_GAP) {
+      after_gap = true;
+      continue;
+    }
+    TransitionRecord r;
+    r.reserved = 0;
+    r.flags = 0;
+
+    uint8_t from = e.kind == LOG_RESET ? state : e.from;
+    uint8_t to = e.kind == LOG_RESET ? (uint8_t)INIT : e.to;
+
+    if (e.has_time) {
+      // Serial monitor stamps restart at midnight
+      if (have_time && e.time_ms + DAY_MS / 2 < last_raw) day_offset += DAY_MS;
+      last_raw = e.time_ms;
+      t = e.time_ms + day_offset;
+      have_time = true;
+    } else {
+      r.flags |= TRANSITION_TIME_INFERRED;
+      // At least 1 ms apart so the inferred stimulus keeps every step in
+      // order; a reset comes after the transition before it, not with it
+      unsigned long dwell = 0;
+      if (e.kind == LOG_TRANSITION) dwell = minimumDwell(from, to, emergencyCaused(events, i), plan);
+      t += dwell > 0 ? dwell : 1;
+    }
+    if (t > UINT32_MAX) return false;
+
+    state = to;
+    if (e.kind == LOG_RESET) {
+      r.flags |= TRANSITION_RESET;
+      // Held reset prints once per 500 ms while already in INIT
+      if (from == INIT && !out.empty() && (out.back().flags & TRANSITION_RESET)) continue;
+    }
+    if (after_gap) {
+      r.flags |= TRANSITION_AFTER_GAP;
+      after_gap = false;
+    }
+    r.t_ms = (uint32_t)t;
+    r.from = from;
+    r.to = to;
+    out.push_back(r);
+  }
+  return true;
+}
+
+void inferStimulus(const std::vector<TransitionRecord> &transitions, const TimingPlan &plan,
+                   std::vector<StimulusRecord> &out) {
+  uint8_t inputs = 0;
+  uint32_t ew_green_start = 0;
+
+  for (size_t i = 0; i < transitions.size(); i++) {
+    const TransitionRecord &r = transitions[i];
+
+    if (r.flags & TRANSITION_RESET) {
+      // Reset was held until the FSM could leave INIT at the next stamp:
+      // INIT_MS earlier for NS_GREEN, at once for an emergency
+      uint32_t release_ms = r.t_ms + 1;
+      if (i + 1 < transitions.size() && transitions[i + 1].from == INIT &&
+          !(transitions[i + 1].flags & TRANSITION_TIME_INFERRED)) {
+        const TransitionRecord &after = transitions[i + 1];
+        uint32_t hold = after.to == NS_GREEN ? plan.init_ms : 0;
+        if (after.t_ms >= r.t_ms + hold) release_ms = after.t_ms - hold;
+      }
+      // Inputs restart from idle; the transition out of INIT sets them again
+      StimulusRecord pulse = { r.t_ms, IN_RESET, { 0, 0, 0 } };
+      StimulusRecord release = { release_ms, 0, { 0, 0, 0 } };
+      out.push_back(pulse);
+      out.push_back(release);
+      inputs = 0;
+      continue;
+    }
+
+    bool next_is_emergency_trans = i + 1 < transitions.size() &&
+                                   transitions[i + 1].from == EW_YELLOW &&
+                                   transitions[i + 1].to == EMERGENCY_TRANS;
+    uint8_t next = inputs;
+    uint32_t change_ms = r.t_ms; // When `next` takes effect
+
+    // EW demand only matters in NS_GREEN and NS demand only in EW_GREEN, so
+    // each is held from the green it ended until that green starts again.
+    // A simulated green that runs a little long still sees the demand.
+    if (r.to == NS_GREEN) next &= ~IN_EW_ANY;
+    if (r.to == EW_GREEN) next &= ~IN_NS_ANY;
+
+    if (r.to == EMERGENCY_TRANS || r.to == EMERGENCY_GREEN ||
+        (r.from == EW_GREEN && r.to == EW_YELLOW && next_is_emergency_trans)) {
+      next |= IN_EMERGENCY;
+    } else if (r.from == EMERGENCY_TRANS || r.from == EMERGENCY_GREEN) {
+      next &= ~IN_EMERGENCY;
+    } else if (r.from == NS_GREEN && r.to == NS_YELLOW) {
+      next |= IN_EW1;
+    } else if (r.from == EW_GREEN && r.to == EW_YELLOW &&
+               r.t_ms - ew_green_start < plan.ew_green_ms &&
+               !(r.flags & TRANSITION_TIME_INFERRED)) {
+      // Cut short by an emergency that ended before the yellow did
+      StimulusRecord pulse = { r.t_ms, (uint8_t)(next | IN_EMERGENCY), { 0, 0, 0 } };
+      out.push_back(pulse);
+      inputs = next | IN_EMERGENCY;
+      change_ms = r.t_ms + 1;
+    } else if (r.from == EW_GREEN && r.to == EW_YELLOW) {
+      next |= IN_NS1;
+    }
+    if (r.to == EW_GREEN) ew_green_start = r.t_ms;
+
+    if (next != inputs) {
+      StimulusRecord s = { change_ms, next, { 0, 0, 0 } };
+      out.push_back(s);
+      inputs = next;
+    }
+  }
+}
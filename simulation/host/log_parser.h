@@ -0,0 +1,60 @@
+// Parser for Serial logs captured from simulation.cpp.
+//
+// Recognized lines, optionally prefixed by a timestamp in Arduino serial
+// monitor form ("HH:MM:SS.mmm -> ") or as milliseconds ("12345 " / "[12345] "):
+//   State Change: NS_GREEN -> NS_YELLOW
+//   RESET Activated!
+//   Telemetry dropped: 12 records
+// The last marks a gap where the sketch shed log lines, so the state history
+// does not join up across it. The "Emergency ended ..." lines repeat the
+// State Change that follows them and are skipped, as are banners, "Stats:"
+// lines, console replies and anything else unrecognized.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "controller.h"
+#include "trace.h"
+
+enum LogEventKind : uint8_t {
+  LOG_TRANSITION,
+  LOG_RESET,
+  LOG_GAP             // Telemetry dropped
+};
+
+struct LogEvent {
+  uint32_t time_ms;   // As written in the log; time of day for monitor stamps
+  uint8_t kind;       // LogEventKind
+  uint8_t from;       // StateType, LOG_TRANSITION only
+  uint8_t to;
+  uint8_t has_time;
+};
+
+struct LogParseStats {
+  unsigned long long lines;
+  unsigned long long events;
+  unsigned long long gaps;
+  unsigned long long dropped;   // Records the gaps say were shed
+};
+
+// Parses whole lines in [begin, end); `begin` must be at the start of a line
+void parseLogChunk(const char *begin, const char *end, std::vector<LogEvent> &out,
+                   LogParseStats &stats);
+
+// Orders the events into transitions: unwraps time-of-day stamps at
+// midnight, fills in the state a reset left, and gives untimestamped
+// transitions the earliest time the timing plan allows. The first
+// transition after a gap is flagged TRANSITION_AFTER_GAP. Returns false,
+// with the transitions up to that point, if the log runs past 2^32 ms
+// (49.7 days), which trace times cannot hold.
+bool assembleTransitions(const std::vector<LogEvent> &events, const TimingPlan &plan,
+                         std::vector<TransitionRecord> &out);
+
+// Derives input changes that make the controller repeat `transitions`:
+// demand raised where a green ended, emergency held across every
+// emergency sequence and one-millisecond pulses for resets and for
+// emergencies that only cut an EW green short.
+void inferStimulus(const std::vector<TransitionRecord> &transitions, const TimingPlan &plan,
+                   std::vector<StimulusRecord> &out);
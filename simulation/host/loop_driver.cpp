@@ -0,0 +1,100 @@
+// loop_driver: runs simulation.cpp on a Linux host at a fixed loop() period.
+//
+// Each period starts at an absolute CLOCK_MONOTONIC deadline, so a late wake
+// does not push every later period back. With -f/-c/-m the thread runs under
+// SCHED_FIFO, pinned to one CPU with its memory locked, and the histogram
+// printed on exit shows how late each period started.
+//
+// Usage: loop_driver [-p period_us] [-n periods] [-b budget_us] [-c cpu] [-f fifo_priority] [-m]
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arduino_shim.h"
+#include "rt.h"
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void onSignal(int) { stop_requested = 1; }
+
+static long long diffNs(const struct timespec &a, const struct timespec &b) {
+  return (long long)(a.tv_sec - b.tv_sec) * 1000000000LL + (a.tv_nsec - b.tv_nsec);
+}
+
+static void addNs(struct timespec &ts, long long ns) {
+  ts.tv_nsec += ns;
+  while (ts.tv_nsec >= 1000000000L) {
+    ts.tv_nsec -= 1000000000L;
+    ts.tv_sec++;
+  }
+}
+
+int main(int argc, char **argv) {
+  long long period_ns = 1000000; // loop() every millisecond
+  unsigned long long periods = 0; // 0 runs until SIGINT
+  long long budget_ns = 50000;
+  RealtimeOptions rt = DEFAULT_REALTIME;
+  int opt;
+  while ((opt = getopt(argc, argv, "p:n:b:c:f:m")) != -1) {
+    switch (opt) {
+      case 'p': period_ns = atoll(optarg) * 1000; break;
+      case 'n': periods = strtoull(optarg, NULL, 10); break;
+      case 'b': budget_ns = atoll(optarg) * 1000; break;
+      case 'c': rt.cpu = atoi(optarg); break;
+      case 'f': rt.fifo_priority = atoi(optarg); break;
+      case 'm': rt.lock_memory = true; break;
+      default:
+        fprintf(stderr, "Usage: %s [-p period_us] [-n periods] [-b budget_us] [-c cpu] "
+                        "[-f fifo_priority] [-m]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (period_ns <= 0) {
+    fprintf(stderr, "Period must be positive\n");
+    return 1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  // Histogram is allocated and zeroed before memory is locked
+  static JitterHistogram jitter;
+  initJitter(jitter, budget_ns);
+  if (!enterRealtime(rt)) return 1;
+
+  setup();
+
+  unsigned long long missed = 0;
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  for (unsigned long long i = 0; (periods == 0 || i < periods) && !stop_requested; i++) {
+    addNs(deadline, period_ns);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) != 0) {
+      if (stop_requested) break;
+    }
+
+    struct timespec woke;
+    clock_gettime(CLOCK_MONOTONIC, &woke);
+    recordJitter(jitter, diffNs(woke, deadline));
+
+    loop();
+
+    // Skip periods that loop() overran (e.g. the reset delay) instead of bursting
+    struct timespec done;
+    clock_gettime(CLOCK_MONOTONIC, &done);
+    long long overrun = diffNs(done, deadline);
+    if (overrun >= period_ns) {
+      long long skip = overrun / period_ns;
+      missed += skip;
+      addNs(deadline, skip * period_ns);
+    }
+  }
+
+  fflush(stdout);
+  printJitter(jitter, stderr);
+  if (missed > 0) fprintf(stderr, "periods skipped after overruns: %llu\n", missed);
+  return 0;
+}
@@ -0,0 +1,352 @@
+#include "metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <thread>
+
+static const uint64_t DWELL_BOUNDS_US[] = { 1000000, 2000000, 5000000, 10000000, 20000000,
+                                            30000000, 60000000, 120000000, 300000000 };
+static const uint64_t EMERGENCY_BOUNDS_US[] = { 100000, 500000, 1000000, 2000000,
+                                                3000000, 5000000, 10000000 };
+static const uint64_t LATENESS_BOUNDS_US[] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 50000 };
+static const uint64_t BATCH_BOUNDS_US[] = { 1, 2, 5, 10, 20, 50, 100, 500, 1000 };
+
+static const char *const DETECTOR_NAMES[DETECTORS] = { "ns1", "ns2", "ew1", "ew2" };
+
+// Bytes per intersection: 7 entry lines, the state line and 4 detector lines
+const size_t METRICS_BYTES_PER_INTERSECTION = 1280;
+const size_t METRICS_FIXED_BYTES = 32768;
+
+static unsigned long nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)ts.tv_sec * 1000UL + ts.tv_nsec / 1000000L;
+}
+
+template <size_t N>
+static void initHistogram(MetricsHistogram &h, const uint64_t (&bounds)[N]) {
+  static_assert(N <= METRICS_MAX_BUCKETS, "too many histogram buckets");
+  h.bounds_us = bounds;
+  h.buckets = (int)N;
+  for (int i = 0; i <= METRICS_MAX_BUCKETS; i++) h.counts[i].store(0, std::memory_order_relaxed);
+  h.sum_us.store(0, std::memory_order_relaxed);
+}
+
+void initMetrics(DaemonMetrics &m, int count, unsigned long now_ms) {
+  m.count = count;
+  m.inputs.store(0, std::memory_order_relaxed);
+  m.transitions.store(0, std::memory_order_relaxed);
+  m.slow_clients.store(0, std::memory_order_relaxed);
+  for (int s = 0; s < NUM_STATES; s++) initHistogram(m.dwell[s], DWELL_BOUNDS_US);
+  initHistogram(m.emergency_latency, EMERGENCY_BOUNDS_US);
+  initHistogram(m.timer_lateness, LATENESS_BOUNDS_US);
+  initHistogram(m.batch_latency, BATCH_BOUNDS_US);
+
+  // Atomics cannot be copied or moved, so each array is built at size and swapped in
+  std::vector<std::atomic<uint64_t>> entries(count * NUM_STATES);
+  std::vector<std::atomic<uint8_t>> state(count);
+  std::vector<std::atomic<uint8_t>> inputs_now(count);
+  std::vector<std::atomic<uint64_t>> edges(count * DETECTORS);
+  for (size_t i = 0; i < entries.size(); i++) entries[i].store(0, std::memory_order_relaxed);
+  for (int i = 0; i < count; i++) {
+    state[i].store(INIT, std::memory_order_relaxed);
+    inputs_now[i].store(0, std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < edges.size(); i++) edges[i].store(now_ms, std::memory_order_relaxed);
+  m.entries.swap(entries);
+  m.state.swap(state);
+  m.inputs_now.swap(inputs_now);
+  m.detector_edge_ms.swap(edges);
+  m.emergency_since_ms.assign(count, NO_DEADLINE);
+}
+
+void observeHistogram(MetricsHistogram &h, uint64_t value_us) {
+  int b = 0;
+  while (b < h.buckets && value_us > h.bounds_us[b]) b++;
+  bumpCounter(h.counts[b]);
+  bumpCounter(h.sum_us, value_us);
+}
+
+void metricsInput(DaemonMetrics &m, int id, uint8_t inputs, unsigned long now_ms) {
+  bumpCounter(m.inputs);
+  uint8_t previous = m.inputs_now[id].load(std::memory_order_relaxed);
+  uint8_t changed = (uint8_t)(previous ^ inputs);
+  for (int d = 0; d < DETECTORS; d++) {
+    if (changed & (1 << d)) {
+      m.detector_edge_ms[id * DETECTORS + d].store(now_ms, std::memory_order_relaxed);
+    }
+  }
+  if (changed & IN_EMERGENCY) {
+    m.emergency_since_ms[id] = (inputs & IN_EMERGENCY) ? now_ms : NO_DEADLINE;
+  }
+  m.inputs_now[id].store(inputs, std::memory_order_relaxed);
+}
+
+void metricsTransition(DaemonMetrics &m, int id, uint8_t from, unsigned long from_start_ms,
+                       uint8_t to, unsigned long now_ms) {
+  bumpCounter(m.transitions);
+  bumpCounter(m.entries[id * NUM_STATES + to]);
+  m.state[id].store(to, std::memory_order_relaxed);
+  observeHistogram(m.dwell[from], (uint64_t)(now_ms - from_start_ms) * 1000);
+  if (to == EMERGENCY_GREEN && m.emergency_since_ms[id] != NO_DEADLINE) {
+    observeHistogram(m.emergency_latency, (uint64_t)(now_ms - m.emergency_since_ms[id]) * 1000);
+    m.emergency_since_ms[id] = NO_DEADLINE;
+  }
+}
+
+size_t metricsBufferSize(int count) {
+  return METRICS_FIXED_BYTES + (size_t)count * METRICS_BYTES_PER_INTERSECTION;
+}
+
+// --- Text Exposition ---
+struct Output {
+  char *data;
+  size_t capacity;
+  size_t len;
+};
+
+static void appendf(Output &o, const char *fmt, ...) {
+  if (o.len >= o.capacity) return;
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(o.data + o.len, o.capacity - o.len, fmt, args);
+  va_end(args);
+  if (n < 0) return;
+  o.len = o.len + n < o.capacity ? o.len + n : o.capacity;
+}
+
+static void header(Output &o, const char *name, const char *type, const char *help) {
+  appendf(o, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void counter(Output &o, const char *name, const char *help,
+                    const std::atomic<uint64_t> &value) {
+  header(o, name, "counter", help);
+  appendf(o, "%s %llu\n", name, (unsigned long long)value.load(std::memory_order_relaxed));
+}
+
+// `labels` is empty or `key="value",` pairs ending in a comma
+static void histogramSeries(Output &o, const char *name, const char *labels,
+                            const MetricsHistogram &h) {
+  unsigned long long cumulative = 0;
+  for (int b = 0; b <= h.buckets; b++) {
+    cumulative += h.counts[b].load(std::memory_order_relaxed);
+    if (b < h.buckets) {
+      appendf(o, "%s_bucket{%sle=\"%g\"} %llu\n", name, labels, h.bounds_us[b] / 1e6, cumulative);
+    } else {
+      appendf(o, "%s_bucket{%sle=\"+Inf\"} %llu\n", name, labels, cumulative);
+    }
+  }
+  // Sum and count carry the same labels without the trailing comma
+  char braces[64] = "";
+  size_t label_len = strlen(labels);
+  if (label_len > 0) snprintf(braces, sizeof(braces), "{%.*s}", (int)label_len - 1, labels);
+  appendf(o, "%s_sum%s %.6f\n", name, braces, h.sum_us.load(std::memory_order_relaxed) / 1e6);
+  appendf(o, "%s_count%s %llu\n", name, braces, cumulative);
+}
+
+size_t formatMetrics(const DaemonMetrics &m, unsigned long now_ms, char *out, size_t capacity) {
+  Output o = { out, capacity, 0 };
+
+  counter(o, "traffic_inputs_total", "Input records handled.", m.inputs);
+  counter(o, "traffic_transitions_total", "State transitions, input and timer driven.",
+          m.transitions);
+  counter(o, "traffic_slow_clients_total", "Clients dropped for falling behind.", m.slow_clients);
+
+  header(o, "traffic_state_dwell_seconds", "histogram", "Time spent in a state before leaving it.");
+  for (int s = 0; s < NUM_STATES; s++) {
+    char labels[40];
+    snprintf(labels, sizeof(labels), "state=\"%s\",", stateName((StateType)s));
+    histogramSeries(o, "traffic_state_dwell_seconds", labels, m.dwell[s]);
+  }
+  header(o, "traffic_emergency_latency_seconds", "histogram",
+         "Emergency input asserted to EMERGENCY_GREEN.");
+  histogramSeries(o, "traffic_emergency_latency_seconds", "", m.emergency_latency);
+  header(o, "traffic_timer_lateness_seconds", "histogram",
+         "Event loop wake-up past the earliest controller deadline.");
+  histogramSeries(o, "traffic_timer_lateness_seconds", "", m.timer_lateness);
+  header(o, "traffic_input_batch_latency_seconds", "histogram",
+         "Socket read returning to the batch's replies being queued.");
+  histogramSeries(o, "traffic_input_batch_latency_seconds", "", m.batch_latency);
+
+  // Detector health, from the last edge of each detector
+  unsigned long long stuck_on = 0, silent = 0;
+  for (int i = 0; i < m.count; i++) {
+    uint8_t inputs = m.inputs_now[i].load(std::memory_order_relaxed);
+    for (int d = 0; d < DETECTORS; d++) {
+      unsigned long edge = m.detector_edge_ms[i * DETECTORS + d].load(std::memory_order_relaxed);
+      unsigned long age = now_ms > edge ? now_ms - edge : 0;
+      if ((inputs & (1 << d)) && age > DETECTOR_STUCK_ON_MS) stuck_on++;
+      if (age > DETECTOR_SILENT_MS) silent++;
+    }
+  }
+  header(o, "traffic_detectors_stuck_on", "gauge", "Detectors occupied for over 5 minutes.");
+  appendf(o, "traffic_detectors_stuck_on %llu\n", stuck_on);
+  header(o, "traffic_detectors_silent", "gauge", "Detectors unchanged for over an hour.");
+  appendf(o, "traffic_detectors_silent %llu\n", silent);
+
+  header(o, "traffic_state", "gauge",
+         "Current state: 0 INIT, 1 NS_GREEN, 2 NS_YELLOW, 3 EW_GREEN, 4 EW_YELLOW, "
+         "5 EMERGENCY_TRANS, 6 EMERGENCY_GREEN.");
+  for (int i = 0; i < m.count; i++) {
+    appendf(o, "traffic_state{intersection=\"%d\"} %u\n", i,
+            (unsigned)m.state[i].load(std::memory_order_relaxed));
+  }
+  header(o, "traffic_state_entries_total", "counter", "Entries into each state.");
+  for (int i = 0; i < m.count; i++) {
+    for (int s = 0; s < NUM_STATES; s++) {
+      appendf(o, "traffic_state_entries_total{intersection=\"%d\",state=\"%s\"} %llu\n", i,
+              stateName((StateType)s),
+              (unsigned long long)m.entries[i * NUM_STATES + s].load(std::memory_order_relaxed));
+    }
+  }
+  header(o, "traffic_detector_unchanged_seconds", "gauge", "Time since a detector last changed.");
+  for (int i = 0; i < m.count; i++) {
+    for (int d = 0; d < DETECTORS; d++) {
+      unsigned long edge = m.detector_edge_ms[i * DETECTORS + d].load(std::memory_order_relaxed);
+      unsigned long age = now_ms > edge ? now_ms - edge : 0;
+      appendf(o, "traffic_detector_unchanged_seconds{intersection=\"%d\",detector=\"%s\"} %.3f\n",
+              i, DETECTOR_NAMES[d], age / 1000.0);
+    }
+  }
+  return o.len;
+}
+
+// --- Exporter Thread ---
+static std::thread exporter_thread;
+static std::atomic<bool> exporter_stop(false);
+static std::vector<char> exposition;  // Sized once, reused by every scrape
+
+static int openMetricsPort(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static bool sendAll(int fd, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+// Answers one HTTP request; anything but GET /metrics gets a 404
+static void serveScrape(const DaemonMetrics &m, int fd) {
+  struct timeval timeout = { 1, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  char request[2048];
+  size_t len = 0;
+  while (len < sizeof(request) - 1) {
+    ssize_t n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+    if (n <= 0) break;
+    len += n;
+    request[len] = '\0';
+    if (strstr(request, "\r\n\r\n")) break;
+  }
+  request[len] = '\0';
+
+  char head[160];
+  if (strncmp(request, "GET /metrics ", 13) != 0) {
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    sendAll(fd, head, n);
+    return;
+  }
+  size_t body = formatMetrics(m, nowMs(), exposition.data(), exposition.size());
+  int n = snprintf(head, sizeof(head),
+                   "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                   "Content-Length: %zu\r\nConnection: close\r\n\r\n", body);
+  if (sendAll(fd, head, n)) sendAll(fd, exposition.data(), body);
+}
+
+// Writes the exposition beside `path` and renames it over, so readers never
+// see a partial file
+static void writeTextfile(const DaemonMetrics &m, const char *path) {
+  char tmp[4096];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  // Plain file descriptors: stdio would allocate a FILE per write
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return;
+  size_t body = formatMetrics(m, nowMs(), exposition.data(), exposition.size());
+  const char *data = exposition.data();
+  size_t left = body;
+  while (left > 0) {
+    ssize_t n = write(fd, data, left);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    data += n;
+    left -= n;
+  }
+  if (close(fd) == 0 && left == 0) rename(tmp, path);
+}
+
+static void exporterMain(const DaemonMetrics *m, int listen_fd, const char *textfile,
+                         int period_s) {
+  unsigned long next_write = nowMs();
+  while (!exporter_stop.load(std::memory_order_relaxed)) {
+    // Wake at least every 200 ms to notice a stop request
+    int timeout = 200;
+    if (textfile) {
+      unsigned long now = nowMs();
+      if (now >= next_write) {
+        writeTextfile(*m, textfile);
+        next_write = now + (unsigned long)period_s * 1000;
+      }
+      if (next_write - now < (unsigned long)timeout) timeout = (int)(next_write - now);
+    }
+    struct pollfd p = { listen_fd, POLLIN, 0 };
+    if (poll(&p, listen_fd >= 0 ? 1 : 0, timeout) <= 0) continue;
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) continue;
+    serveScrape(*m, fd);
+    close(fd);
+  }
+  if (listen_fd >= 0) close(listen_fd);
+}
+
+bool startMetricsExporter(DaemonMetrics &m, int port, const char *textfile, int period_s) {
+  if (port <= 0 && !textfile) return true;
+  int listen_fd = -1;
+  if (port > 0) {
+    listen_fd = openMetricsPort(port);
+    if (listen_fd < 0) {
+      perror("metrics port");
+      return false;
+    }
+  }
+  exposition.assign(metricsBufferSize(m.count), 0);
+  exporter_stop.store(false);
+  exporter_thread = std::thread(exporterMain, &m, listen_fd, textfile, period_s > 0 ? period_s : 1);
+  return true;
+}
+
+void stopMetricsExporter() {
+  if (!exporter_thread.joinable()) return;
+  exporter_stop.store(true);
+  exporter_thread.join();
+}
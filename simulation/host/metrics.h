@@ -0,0 +1,84 @@
+// Prometheus-style metrics for traffic_daemon.
+//
+// The control thread is the only writer. It records with relaxed atomic
+// loads and stores (no locked read-modify-write), which compile to the same
+// instructions as plain counters. An exporter thread reads them with relaxed
+// loads and formats the text exposition into a buffer sized at startup, so a
+// scrape never blocks or allocates on the control path's behalf; a scrape
+// may see one intersection's counters a step apart, never torn values.
+//
+// Exported, fleet-wide: inputs, transitions, slow clients, dwell time per
+// state, emergency latency (input asserted to EMERGENCY_GREEN), timer
+// lateness of the event loop, input batch latency and counts of stuck or
+// silent detectors. Per intersection: entries into each state, the current
+// state and the time since each detector last changed.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+#include "controller.h"
+
+const int DETECTORS = 4;                       // IN_NS1..IN_EW2
+const int METRICS_MAX_BUCKETS = 10;
+const unsigned long DETECTOR_STUCK_ON_MS = 300000;  // Held longer: stuck on
+const unsigned long DETECTOR_SILENT_MS = 3600000;   // Unchanged longer: silent
+
+// Cumulative histogram over fixed upper bounds in microseconds
+struct MetricsHistogram {
+  const uint64_t *bounds_us;
+  int buckets;                                  // Finite bounds; +Inf is implicit
+  std::atomic<uint64_t> counts[METRICS_MAX_BUCKETS + 1];
+  std::atomic<uint64_t> sum_us;
+};
+
+struct DaemonMetrics {
+  int count;
+
+  std::atomic<uint64_t> inputs;
+  std::atomic<uint64_t> transitions;
+  std::atomic<uint64_t> slow_clients;
+  MetricsHistogram dwell[NUM_STATES];           // Time spent in a state before leaving it
+  MetricsHistogram emergency_latency;
+  MetricsHistogram timer_lateness;              // Wake-up past the earliest controller deadline
+  MetricsHistogram batch_latency;               // Read returning to decisions queued
+
+  // Per intersection, published for the exporter
+  std::vector<std::atomic<uint64_t>> entries;   // count * NUM_STATES
+  std::vector<std::atomic<uint8_t>> state;
+  std::vector<std::atomic<uint8_t>> inputs_now;
+  std::vector<std::atomic<uint64_t>> detector_edge_ms; // count * DETECTORS
+
+  // Control thread only
+  std::vector<unsigned long> emergency_since_ms; // NO_DEADLINE when not requested
+};
+
+void initMetrics(DaemonMetrics &m, int count, unsigned long now_ms);
+
+// Records a new input mask for `id` (before it is applied)
+void metricsInput(DaemonMetrics &m, int id, uint8_t inputs, unsigned long now_ms);
+
+// Records `id` moving from `from`, entered at `from_start_ms`, to `to`
+void metricsTransition(DaemonMetrics &m, int id, uint8_t from, unsigned long from_start_ms,
+                       uint8_t to, unsigned long now_ms);
+
+void observeHistogram(MetricsHistogram &h, uint64_t value_us);
+
+// Single-writer counter increment
+inline void bumpCounter(std::atomic<uint64_t> &counter, uint64_t n = 1) {
+  counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Bytes formatMetrics() needs for `count` intersections
+size_t metricsBufferSize(int count);
+
+// Writes the text exposition; returns its length (cut short at `capacity`)
+size_t formatMetrics(const DaemonMetrics &m, unsigned long now_ms, char *out, size_t capacity);
+
+// Starts the exporter thread: HTTP GET /metrics on 127.0.0.1:`port` (0 for
+// none) and/or `textfile` rewritten atomically every `period_s` seconds
+// (NULL for none). Call during setup; the buffers are allocated here.
+bool startMetricsExporter(DaemonMetrics &m, int port, const char *textfile, int period_s);
+void stopMetricsExporter();
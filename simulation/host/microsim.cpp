@@ -0,0 +1,383 @@
+#include "microsim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+const size_t VEHICLE_ARRAY_ALIGN = 64;
+const float FREE_ROAD_GAP = 1000.0f;  // Gap seen by a lead vehicle with nothing ahead
+
+static const PlatoonConfig ADVANCE_LOOPS = {
+  ADVANCE_DETECTOR_M,
+  VEHICLE_LENGTH + ADVANCE_DETECTOR_LEN,
+  1.0f
+};
+
+// --- Setup ---
+static size_t alignUp(size_t n) {
+  return (n + VEHICLE_ARRAY_ALIGN - 1) & ~(VEHICLE_ARRAY_ALIGN - 1);
+}
+
+// Slots for twice the jam density, so removals from the front only need a
+// compaction once the back of the array is reached
+static uint32_t segmentCapacity(float length_m) {
+  uint32_t jam = (uint32_t)(length_m / (VEHICLE_LENGTH + IDM_MIN_GAP)) + 2;
+  return (2 * jam + 15) & ~15u;
+}
+
+static size_t segmentBytes(uint32_t capacity) {
+  return 3 * alignUp(capacity * sizeof(float)) + alignUp(capacity);
+}
+
+bool initCorridor(MicroSim &sim, uint32_t corridors, uint32_t intersections, float link_m,
+                  uint16_t arterial_vph, uint16_t cross_vph, const TimingPlan &plan,
+                  uint32_t tick_ms, uint32_t seed) {
+  uint32_t signals = corridors * intersections;
+  uint32_t capacity = segmentCapacity(link_m);
+  size_t per_segment = segmentBytes(capacity);
+  size_t len = per_segment * signals * LANES_PER_INTERSECTION;
+  void *arena = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (arena == MAP_FAILED) {
+    perror("mmap");
+    return false;
+  }
+
+  sim.tick_ms = tick_ms;
+  sim.now_ms = 0;
+  sim.rng = seed ? seed : 1;
+  sim.arena = arena;
+  sim.arena_len = len;
+  sim.signals.resize(signals);
+  sim.plans.assign(signals, plan);
+  sim.inputs.assign(signals, 0);
+  sim.segments.resize(signals * LANES_PER_INTERSECTION);
+  sim.platoon_control = false;
+  sim.platoons.resize(sim.segments.size());
+  for (size_t s = 0; s < sim.platoons.size(); s++) initPlatoonTracker(sim.platoons[s]);
+  sim.platoon_action.assign(signals, PLATOON_NONE);
+  sim.holds = 0;
+  sim.calls = 0;
+  sim.spillback_gating = false;
+  sim.spillback.resize(sim.segments.size());
+  for (size_t s = 0; s < sim.spillback.size(); s++) initSpillbackDetector(sim.spillback[s]);
+  sim.spillback_action.assign(signals, SPILLBACK_NONE);
+  sim.skips = 0;
+  sim.shortens = 0;
+
+  char *at = (char *)arena;
+  for (uint32_t k = 0; k < signals; k++) {
+    initController(sim.signals[k], 0);
+    uint32_t along = k % intersections; // Position along its corridor, south to north
+    for (int lane = 0; lane < LANES_PER_INTERSECTION; lane++) {
+      LaneSegment &seg = sim.segments[k * LANES_PER_INTERSECTION + lane];
+      memset(&seg, 0, sizeof(seg));
+      seg.length_m = link_m;
+      seg.intersection = k;
+      seg.capacity = capacity;
+      seg.pos = (float *)at;
+      at += alignUp(capacity * sizeof(float));
+      seg.vel = (float *)at;
+      at += alignUp(capacity * sizeof(float));
+      seg.acc = (float *)at;
+      at += alignUp(capacity * sizeof(float));
+      seg.halted = (uint8_t *)at;
+      at += alignUp(capacity);
+
+      seg.downstream = -1;
+      if (lane == LANE_NS1) {
+        if (along + 1 < intersections) seg.downstream = (k + 1) * LANES_PER_INTERSECTION + LANE_NS1;
+        if (along == 0) seg.rate_vph = arterial_vph;
+      } else if (lane == LANE_NS2) {
+        if (along > 0) seg.downstream = (k - 1) * LANES_PER_INTERSECTION + LANE_NS2;
+        if (along + 1 == intersections) seg.rate_vph = arterial_vph;
+      } else {
+        seg.rate_vph = cross_vph;
+      }
+    }
+  }
+  return true;
+}
+
+void freeMicroSim(MicroSim &sim) {
+  if (sim.arena) munmap(sim.arena, sim.arena_len);
+  sim.arena = NULL;
+  sim.segments.clear();
+  sim.signals.clear();
+  sim.plans.clear();
+  sim.inputs.clear();
+  sim.platoons.clear();
+  sim.platoon_action.clear();
+  sim.spillback.clear();
+  sim.spillback_action.clear();
+}
+
+uint64_t vehicleCount(const MicroSim &sim) {
+  uint64_t n = 0;
+  for (size_t s = 0; s < sim.segments.size(); s++) n += sim.segments[s].count;
+  return n;
+}
+
+// --- Vehicle Arrays ---
+static bool pushVehicle(LaneSegment &seg, float pos, float vel, uint8_t halted) {
+  if (seg.count >= seg.capacity / 2) return false;
+  if (seg.head + seg.count == seg.capacity) {
+    memmove(seg.pos, seg.pos + seg.head, seg.count * sizeof(float));
+    memmove(seg.vel, seg.vel + seg.head, seg.count * sizeof(float));
+    memmove(seg.halted, seg.halted + seg.head, seg.count);
+    seg.head = 0;
+  }
+  uint32_t k = seg.head + seg.count++;
+  seg.pos[k] = pos;
+  seg.vel[k] = vel;
+  seg.halted[k] = halted;
+  return true;
+}
+
+// --- Stepping ---
+static uint32_t xorshift(uint32_t &s) {
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return s;
+}
+
+static float idmAccel(float v, float gap, float dv) {
+  const float inv_v0 = 1.0f / IDM_DESIRED_SPEED;
+  const float brake = 0.5f / sqrtf(IDM_MAX_ACCEL * IDM_COMFORT_DECEL);
+  float dynamic = v * IDM_TIME_HEADWAY + v * dv * brake;
+  float desired = IDM_MIN_GAP + (dynamic > 0 ? dynamic : 0);
+  float r = v * inv_v0;
+  float z = desired / (gap > 0.1f ? gap : 0.1f);
+  return IDM_MAX_ACCEL * (1.0f - r * r * r * r - z * z);
+}
+
+// True while an arterial vehicle that crossed intersection k has not yet
+// cleared the box
+static bool boxBlocked(const MicroSim &sim, uint32_t k) {
+  for (int lane = LANE_NS1; lane <= LANE_NS2; lane++) {
+    int32_t down = sim.segments[k * LANES_PER_INTERSECTION + lane].downstream;
+    if (down < 0) continue;
+    const LaneSegment &next = sim.segments[down];
+    if (next.count > 0 && next.pos[next.head + next.count - 1] - VEHICLE_LENGTH < INTERSECTION_BOX_M) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// What the vehicle nearest the stop line follows: the stop line itself, or
+// the back of the queue on the next link
+static void leadObstacle(const MicroSim &sim, const LaneSegment &seg, int lane, float &gap,
+                         float &lead_v) {
+  float p = seg.pos[seg.head];
+  float v = seg.vel[seg.head];
+  float to_line = seg.length_m - p;
+  uint8_t lights = lightsForState(sim.signals[seg.intersection].current_state);
+  bool ns = lane == LANE_NS1 || lane == LANE_NS2;
+  bool green = (lights & (ns ? LIGHT_NS_G : LIGHT_EW_G)) != 0;
+  bool yellow = (lights & (ns ? LIGHT_NS_Y : LIGHT_EW_Y)) != 0;
+  // On yellow, go only when stopping would take harder than comfortable braking
+  bool go = green || (yellow && to_line < v * v / (2 * IDM_COMFORT_DECEL));
+  if (go && !ns && to_line > 0.5f && boxBlocked(sim, seg.intersection)) go = false;
+
+  gap = FREE_ROAD_GAP;
+  lead_v = v;
+  if (!go) {
+    gap = to_line;
+    lead_v = 0;
+  } else if (seg.downstream >= 0) {
+    const LaneSegment &down = sim.segments[seg.downstream];
+    if (down.count >= down.capacity / 2) {
+      gap = to_line;
+      lead_v = 0;
+    } else if (down.count > 0) {
+      uint32_t tail = down.head + down.count - 1;
+      gap = to_line + down.pos[tail] - VEHICLE_LENGTH;
+      lead_v = down.vel[tail];
+    }
+  }
+}
+
+static void accelerate(const MicroSim &sim, LaneSegment &seg, int lane) {
+  uint32_t n = seg.count;
+  if (n == 0) return;
+  const float *__restrict pos = seg.pos + seg.head;
+  const float *__restrict vel = seg.vel + seg.head;
+  float *__restrict acc = seg.acc + seg.head;
+
+  float gap, lead_v;
+  leadObstacle(sim, seg, lane, gap, lead_v);
+  acc[0] = idmAccel(vel[0], gap, vel[0] - lead_v);
+
+  // Followers: same formula as idmAccel(), inlined so the loop vectorizes
+  const float inv_v0 = 1.0f / IDM_DESIRED_SPEED;
+  const float brake = 0.5f / sqrtf(IDM_MAX_ACCEL * IDM_COMFORT_DECEL);
+  for (uint32_t i = 1; i < n; i++) {
+    float v = vel[i];
+    float s = pos[i - 1] - pos[i] - VEHICLE_LENGTH;
+    float dynamic = v * IDM_TIME_HEADWAY + v * (v - vel[i - 1]) * brake;
+    float desired = IDM_MIN_GAP + (dynamic > 0 ? dynamic : 0.0f);
+    float r = v * inv_v0;
+    float z = desired / (s > 0.1f ? s : 0.1f);
+    acc[i] = IDM_MAX_ACCEL * (1.0f - r * r * r * r - z * z);
+  }
+}
+
+static void integrate(LaneSegment &seg, float dt) {
+  uint32_t n = seg.count;
+  float *__restrict pos = seg.pos + seg.head;
+  float *__restrict vel = seg.vel + seg.head;
+  const float *__restrict acc = seg.acc + seg.head;
+  uint8_t *__restrict halted = seg.halted + seg.head;
+
+  const float inv_v0 = 1.0f / IDM_DESIRED_SPEED;
+  float lost = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    float v = vel[i] + acc[i] * dt;
+    v = v > 0 ? v : 0.0f;
+    pos[i] += (vel[i] + v) * 0.5f * dt;
+    vel[i] = v;
+    lost += 1.0f - v * inv_v0;
+  }
+  // Kept apart from the loop above, which GCC will not if-convert with it
+  uint32_t stops = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    int32_t h = vel[i] < HALTED_SPEED ? 1 : 0;
+    stops += h & (halted[i] ^ 1);
+    halted[i] = (uint8_t)h;
+  }
+  seg.stops += stops;
+  seg.delay_s += lost * dt;
+}
+
+// Moves vehicles past the stop line onto the next link or out of the corridor
+static void crossStopLine(MicroSim &sim, LaneSegment &seg) {
+  while (seg.count > 0 && seg.pos[seg.head] >= seg.length_m) {
+    uint32_t k = seg.head;
+    if (seg.downstream >= 0 &&
+        !pushVehicle(sim.segments[seg.downstream], seg.pos[k] - seg.length_m, seg.vel[k],
+                     seg.halted[k])) {
+      // Next link filled up this tick: wait at the line
+      seg.pos[k] = seg.length_m - 0.01f;
+      seg.vel[k] = 0;
+      break;
+    }
+    if (seg.downstream < 0) seg.exited++;
+    seg.served++;
+    seg.head++;
+    seg.count--;
+  }
+}
+
+// Generates arrivals and lets at most one backlogged vehicle enter
+static void enterDemand(LaneSegment &seg, uint32_t &rng, uint32_t tick_ms, float dt) {
+  uint64_t threshold = (uint64_t)seg.rate_vph * tick_ms * 4294967296ULL / 3600000ULL;
+  if (xorshift(rng) < threshold) seg.backlog++;
+  if (seg.backlog == 0) return;
+
+  float speed = IDM_DESIRED_SPEED;
+  if (seg.count > 0) {
+    uint32_t tail = seg.head + seg.count - 1;
+    float space = seg.pos[tail] - VEHICLE_LENGTH;
+    if (seg.vel[tail] < speed) speed = seg.vel[tail];
+    if (space < IDM_MIN_GAP + speed * IDM_TIME_HEADWAY) speed = -1;
+  }
+  if (speed >= 0 && pushVehicle(seg, 0, speed, speed < HALTED_SPEED)) seg.backlog--;
+  seg.delay_s += seg.backlog * dt;
+}
+
+static void readDetectors(MicroSim &sim, size_t s, int lane, uint32_t tick_ms) {
+  LaneSegment &seg = sim.segments[s];
+  bool stopbar = seg.count > 0 && seg.pos[seg.head] >= seg.length_m - STOPBAR_DETECTOR_M;
+
+  // Vehicles are ordered front to back: the first one whose rear is not
+  // yet past the loop decides its occupancy
+  float loop_end = seg.length_m - ADVANCE_DETECTOR_M;
+  float loop_start = loop_end - ADVANCE_DETECTOR_LEN;
+  bool advance = false;
+  for (uint32_t i = seg.head; i < seg.head + seg.count; i++) {
+    if (seg.pos[i] - VEHICLE_LENGTH > loop_end) continue;
+    advance = seg.pos[i] >= loop_start;
+    break;
+  }
+
+  // From the back: the last vehicle whose front has reached the entry loop
+  float entry_start = SPILLBACK_DETECTOR_M;
+  float entry_end = entry_start + SPILLBACK_DETECTOR_LEN;
+  bool entry = false;
+  for (uint32_t i = seg.head + seg.count; i-- > seg.head;) {
+    if (seg.pos[i] < entry_start) continue;
+    entry = seg.pos[i] - VEHICLE_LENGTH <= entry_end;
+    break;
+  }
+  if (entry != sim.spillback[s].occupied) {
+    spillbackEdge(sim.spillback[s], entry, (uint32_t)sim.now_ms);
+  }
+
+  if (advance != seg.advance_on) {
+    platoonLoopEdge(sim.platoons[s], advance, (uint32_t)sim.now_ms, ADVANCE_LOOPS);
+    if (advance) seg.advance_count++;
+  }
+  if (stopbar) seg.stopbar_on_ms += tick_ms;
+  if (advance) seg.advance_on_ms += tick_ms;
+  seg.stopbar_on = stopbar;
+  seg.advance_on = advance;
+  if (stopbar) sim.inputs[seg.intersection] |= (uint8_t)(1 << lane);
+}
+
+void stepMicroSim(MicroSim &sim) {
+  sim.now_ms += sim.tick_ms;
+  unsigned long now = (unsigned long)sim.now_ms;
+  float dt = sim.tick_ms / 1000.0f;
+
+  for (size_t k = 0; k < sim.signals.size(); k++) {
+    ControllerState &c = sim.signals[k];
+    uint8_t inputs = sim.inputs[k];
+    if (sim.platoon_control) {
+      PlatoonAction action;
+      inputs = platoonInputs(c, inputs, (uint32_t)now, sim.plans[k],
+                             &sim.platoons[k * LANES_PER_INTERSECTION], action);
+      if (action != sim.platoon_action[k]) {
+        if (action == PLATOON_HOLD) sim.holds++;
+        if (action == PLATOON_CALL) sim.calls++;
+        sim.platoon_action[k] = action;
+      }
+    }
+    TimingPlan plan = sim.plans[k];
+    if (sim.spillback_gating) {
+      uint8_t blocked = 0;
+      for (int lane = 0; lane < LANES_PER_INTERSECTION; lane++) {
+        int32_t down = sim.segments[k * LANES_PER_INTERSECTION + lane].downstream;
+        if (down >= 0 && spillbackBlocked(sim.spillback[down], (uint32_t)now)) {
+          blocked |= (uint8_t)(1 << lane);
+        }
+      }
+      SpillbackAction action;
+      inputs = spillbackInputs(c, inputs, sim.inputs[k], blocked, plan, action);
+      if (action != sim.spillback_action[k]) {
+        if (action == SPILLBACK_SKIP) sim.skips++;
+        if (action == SPILLBACK_SHORTEN) sim.shortens++;
+        sim.spillback_action[k] = action;
+      }
+    }
+    if (stepController(c, inputs, now, plan)) {
+      while (nextDeadline(c, inputs, plan) <= now) {
+        if (!stepController(c, inputs, now, plan)) break;
+      }
+    }
+  }
+
+  // All accelerations come from the positions at the start of the tick
+  size_t n = sim.segments.size();
+  for (size_t s = 0; s < n; s++) accelerate(sim, sim.segments[s], s % LANES_PER_INTERSECTION);
+  for (size_t s = 0; s < n; s++) integrate(sim.segments[s], dt);
+  for (size_t s = 0; s < n; s++) crossStopLine(sim, sim.segments[s]);
+
+  for (size_t k = 0; k < sim.inputs.size(); k++) sim.inputs[k] = 0;
+  for (size_t s = 0; s < n; s++) {
+    LaneSegment &seg = sim.segments[s];
+    if (seg.rate_vph > 0 || seg.backlog > 0) enterDemand(seg, sim.rng, sim.tick_ms, dt);
+    readDetectors(sim, s, s % LANES_PER_INTERSECTION, sim.tick_ms);
+  }
+}
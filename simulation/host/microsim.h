@@ -0,0 +1,130 @@
+// Lane-level car-following simulation of signalized corridors.
+//
+// Every approach lane is a segment holding its vehicles as parallel arrays
+// (position, speed, acceleration, halted flag), ordered from the vehicle
+// nearest the stop line backwards. Vehicles follow the Intelligent Driver
+// Model: the first vehicle in a segment follows the stop line while its
+// signal is red, or the last vehicle of the next segment while it is green,
+// so queues reaching back across a link hold up the intersection upstream;
+// an arterial vehicle stuck in the intersection also blocks the cross street.
+// Each update is a few flat loops per segment (accelerations, integration,
+// stop counting) that vectorize, with only the lead vehicle handled apart.
+//
+// A corridor is a row of intersections along a two-way NS arterial. The
+// northbound (NS1) and southbound (NS2) lanes run through every
+// intersection; the EW1 and EW2 cross-street lanes feed one intersection
+// each. Stop-bar presence detectors drive the controller's IN_NS1..IN_EW2
+// inputs, and an advance detector upstream of each stop line counts vehicles
+// and feeds a platoon tracker (platoon.h), which can hold or call greens. A
+// loop just inside each link's entry watches for queues spilling back to the
+// upstream intersection (spillback.h), which can gate the greens feeding it.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "controller.h"
+#include "platoon.h"
+#include "spillback.h"
+
+// --- Driver and Vehicle Parameters (IDM) ---
+const float IDM_DESIRED_SPEED = 13.9f;   // m/s, 50 km/h
+const float IDM_TIME_HEADWAY = 1.5f;     // s
+const float IDM_MIN_GAP = 2.0f;          // m, bumper to bumper at standstill
+const float IDM_MAX_ACCEL = 1.5f;        // m/s^2
+const float IDM_COMFORT_DECEL = 2.0f;    // m/s^2
+const float VEHICLE_LENGTH = 4.5f;       // m
+const float HALTED_SPEED = 0.5f;         // Below this a vehicle counts as stopped
+
+// --- Detectors ---
+const float STOPBAR_DETECTOR_M = 6.0f;   // Presence zone just behind the stop line
+const float ADVANCE_DETECTOR_M = 55.0f;  // Advance loop distance from the stop line
+const float ADVANCE_DETECTOR_LEN = 2.0f;
+const float SPILLBACK_DETECTOR_M = 15.0f; // Exit-side presence zone, just past the box
+const float SPILLBACK_DETECTOR_LEN = 6.0f; // Longer than a standstill gap
+
+// An arterial vehicle within this distance past the stop line is still in the
+// intersection: cross traffic waits for it, even on green
+const float INTERSECTION_BOX_M = 15.0f;
+
+// Segment lanes within an intersection, in IN_* bit order
+enum LaneIndex {
+  LANE_NS1,   // Northbound arterial
+  LANE_NS2,   // Southbound arterial
+  LANE_EW1,
+  LANE_EW2,
+  LANES_PER_INTERSECTION
+};
+
+struct LaneSegment {
+  float length_m;          // Entry to stop line
+  int32_t downstream;      // Segment entered past the stop line, -1 leaves the corridor
+  uint32_t intersection;   // Signal at the stop line
+  uint32_t capacity;       // Array slots; at most capacity / 2 vehicles at once
+  uint32_t head;           // Slot of the vehicle nearest the stop line
+  uint32_t count;
+
+  // Vehicle arrays, `capacity` slots each
+  float *pos;              // Front bumper, metres from the segment entry
+  float *vel;
+  float *acc;
+  uint8_t *halted;
+
+  // Demand entering at the segment start (corridor entry lanes only)
+  uint16_t rate_vph;
+  uint32_t backlog;        // Generated but not yet room to enter
+
+  // Detectors
+  bool stopbar_on;
+  bool advance_on;
+  uint64_t stopbar_on_ms;  // Total occupied time
+  uint64_t advance_on_ms;
+  uint32_t advance_count;  // Rising edges
+
+  // Measures
+  uint64_t served;         // Vehicles across the stop line
+  uint64_t exited;         // Of those, vehicles that left the corridor
+  uint64_t stops;          // Moving-to-halted transitions
+  double delay_s;          // Time lost against the desired speed, backlog included
+};
+
+struct MicroSim {
+  uint32_t tick_ms;
+  uint64_t now_ms;
+  uint32_t rng;
+
+  std::vector<LaneSegment> segments;        // LANES_PER_INTERSECTION per intersection
+  std::vector<ControllerState> signals;
+  std::vector<TimingPlan> plans;            // Per intersection, retimable after init
+  std::vector<uint8_t> inputs;              // Stop-bar detector mask per intersection
+
+  bool platoon_control;                     // Step the FSM on platoonInputs()
+  std::vector<PlatoonTracker> platoons;     // One per segment, at its advance loop
+  std::vector<uint8_t> platoon_action;      // Last PlatoonAction per intersection
+  uint64_t holds;                           // Greens held for a platoon
+  uint64_t calls;                           // Approaches called ahead of a platoon
+
+  bool spillback_gating;                    // Gate greens with spillbackInputs()
+  std::vector<SpillbackDetector> spillback; // One per segment, at its entry loop
+  std::vector<uint8_t> spillback_action;    // Last SpillbackAction per intersection
+  uint64_t skips;                           // Calls withheld for a blocked link
+  uint64_t shortens;                        // Greens cut short for a blocked link
+
+  void *arena;                              // Backs every segment's vehicle arrays
+  size_t arena_len;
+};
+
+// Builds `corridors` independent corridors of `intersections` signals each,
+// `link_m` apart. Arterial entries see `arterial_vph` per direction and every
+// cross street `cross_vph`. Every signal starts on `plan`.
+bool initCorridor(MicroSim &sim, uint32_t corridors, uint32_t intersections, float link_m,
+                  uint16_t arterial_vph, uint16_t cross_vph, const TimingPlan &plan,
+                  uint32_t tick_ms, uint32_t seed);
+void freeMicroSim(MicroSim &sim);
+
+// Advances signals, vehicles, demand and detectors by one tick
+void stepMicroSim(MicroSim &sim);
+
+// Vehicles currently on the road
+uint64_t vehicleCount(const MicroSim &sim);
@@ -0,0 +1,107 @@
+#include "mpc.h"
+
+const float SATURATION_FLOW_PER_S = 1000.0f / SATURATION_HEADWAY_MS;
+const float DEMAND_THRESHOLD = 0.5f; // Expected queue at which the detector counts as on
+
+void initMpcConfig(MpcConfig &config, const TimingPlan &plan) {
+  static const float FACTORS[] = { 0.5f, 0.75f, 1.0f, 1.5f, 2.0f };
+  const int n = sizeof(FACTORS) / sizeof(FACTORS[0]);
+  config.horizon_ms = 120000;
+  config.tick_ms = 500;
+  config.oracle_queues = false;
+  config.candidate_count = 0;
+  for (int a = 0; a < n; a++) {
+    for (int b = 0; b < n; b++) {
+      int c = config.candidate_count++;
+      config.ns_green_ms[c] = (uint32_t)(plan.ns_green_ms * FACTORS[a]);
+      config.ew_green_ms[c] = (uint32_t)(plan.ew_green_ms * FACTORS[b]);
+    }
+  }
+}
+
+int mpcChoose(const MpcConfig &config, const TimingPlan &plan, StateType state,
+              uint32_t elapsed_ms, const float queue[NUM_APPROACHES],
+              const float arrivals_per_s[NUM_APPROACHES], MpcRollouts &r, float &best_delay) {
+  if (state > EW_YELLOW) return -1;
+
+  const int n = config.candidate_count;
+  for (int c = 0; c < n; c++) {
+    r.state[c] = state;
+    r.elapsed_ms[c] = (float)elapsed_ms;
+    r.ns_green_ms[c] = (float)config.ns_green_ms[c];
+    r.ew_green_ms[c] = (float)config.ew_green_ms[c];
+    r.queue_ns[c] = queue[APPROACH_NS];
+    r.queue_ew[c] = queue[APPROACH_EW];
+    r.delay[c] = 0;
+  }
+
+  const float dt = config.tick_ms / 1000.0f;
+  const float tick = (float)config.tick_ms;
+  const float arrive_ns = arrivals_per_s[APPROACH_NS] * dt;
+  const float arrive_ew = arrivals_per_s[APPROACH_EW] * dt;
+  const float discharge = SATURATION_FLOW_PER_S * dt;
+  const float yellow = (float)plan.yellow_ms;
+  const float init = (float)plan.init_ms;
+
+  for (uint32_t t = 0; t < config.horizon_ms; t += config.tick_ms) {
+    // Same rules as nextState() without emergency, written as selects and
+    // bitwise ops (no short-circuit branches) so the loop vectorizes
+    for (int c = 0; c < n; c++) {
+      int32_t s = r.state[c];
+      int32_t ns_green = s == NS_GREEN;
+      int32_t ew_green = s == EW_GREEN;
+      float qn = r.queue_ns[c] + arrive_ns;
+      float qe = r.queue_ew[c] + arrive_ew;
+      float served_ns = qn < discharge ? qn : discharge;
+      float served_ew = qe < discharge ? qe : discharge;
+      qn -= ns_green ? served_ns : 0.0f;
+      qe -= ew_green ? served_ew : 0.0f;
+
+      float elapsed = r.elapsed_ms[c] + tick;
+      float ns_dwell = r.ns_green_ms[c];
+      float ew_dwell = r.ew_green_ms[c];
+      float green = ns_green ? ns_dwell : ew_dwell;
+      float other = s == INIT ? init : yellow;
+      float dwell = (ns_green | ew_green) ? green : other;
+      int32_t demand = (ns_green & (qe >= DEMAND_THRESHOLD)) | (ew_green & (qn >= DEMAND_THRESHOLD)) |
+                       ((ns_green | ew_green) ^ 1);
+      int32_t leave = (elapsed >= dwell) & demand;
+      int32_t next = ((s == INIT) | (s == EW_YELLOW)) ? (int32_t)NS_GREEN : s + 1;
+
+      r.state[c] = leave ? next : s;
+      r.elapsed_ms[c] = leave ? 0.0f : elapsed;
+      r.queue_ns[c] = qn;
+      r.queue_ew[c] = qe;
+      r.delay[c] += (qn + qe) * dt;
+    }
+  }
+
+  int best = 0;
+  for (int c = 1; c < n; c++) {
+    if (r.delay[c] < r.delay[best]) best = c;
+  }
+  best_delay = r.delay[best];
+  return best;
+}
+
+uint64_t mpcDecide(BatchSim &sim, const MpcConfig &config, MpcRollouts &rollouts) {
+  uint64_t rollout_count = 0;
+  uint32_t now = (uint32_t)sim.header->now_ms;
+  for (uint32_t i = 0; i < sim.header->count; i++) {
+    if (sim.inputs[i] & (IN_EMERGENCY | IN_RESET)) continue;
+    float queue[NUM_APPROACHES];
+    float arrivals[NUM_APPROACHES];
+    for (int a = 0; a < NUM_APPROACHES; a++) {
+      queue[a] = config.oracle_queues ? sim.queue[a][i] : sim.estimate[a][i].queue;
+      arrivals[a] = sim.rate_vph[a][i] / 3600.0f;
+    }
+    float delay;
+    int best = mpcChoose(config, sim.plan, (StateType)sim.state[i], now - sim.start_ms[i], queue,
+                         arrivals, rollouts, delay);
+    if (best < 0) continue;
+    sim.ns_green_ms[i] = config.ns_green_ms[best];
+    sim.ew_green_ms[i] = config.ew_green_ms[best];
+    rollout_count += config.candidate_count;
+  }
+  return rollout_count;
+}
@@ -0,0 +1,52 @@
+// Model-predictive green timing for the batched simulator.
+//
+// At each decision point the intersection's state is forked into one
+// rollout per candidate (NS green, EW green) pair. Every rollout runs the
+// normal-operation FSM against a fluid queue model fed by the demand
+// forecast for a fixed horizon, and the candidate with the least predicted
+// queued vehicle-time is applied. Rollouts are advanced in lockstep as
+// parallel arrays over candidates, so the inner loop is branch-free and
+// vectorizes, and all storage is fixed-size, so deciding never allocates.
+#pragma once
+
+#include <stdint.h>
+
+#include "batch_sim.h"
+
+const int MPC_MAX_CANDIDATES = 64;
+
+struct MpcConfig {
+  uint32_t horizon_ms;   // How far each rollout looks ahead
+  uint32_t tick_ms;      // Rollout step
+  bool oracle_queues;    // Roll out from the true queues instead of the detector estimate
+  int candidate_count;
+  uint32_t ns_green_ms[MPC_MAX_CANDIDATES];
+  uint32_t ew_green_ms[MPC_MAX_CANDIDATES];
+};
+
+// Rollout state, one lane per candidate
+struct MpcRollouts {
+  int32_t state[MPC_MAX_CANDIDATES];
+  float elapsed_ms[MPC_MAX_CANDIDATES];
+  float ns_green_ms[MPC_MAX_CANDIDATES];
+  float ew_green_ms[MPC_MAX_CANDIDATES];
+  float queue_ns[MPC_MAX_CANDIDATES];
+  float queue_ew[MPC_MAX_CANDIDATES];
+  float delay[MPC_MAX_CANDIDATES];    // Predicted vehicle-seconds queued
+};
+
+// Candidates on a grid of 0.5x-2x the plan's green times, 120 s horizon
+void initMpcConfig(MpcConfig &config, const TimingPlan &plan);
+
+// Rolls every candidate forward from the given state and returns the index
+// of the one with the least predicted delay, or -1 if the state is outside
+// normal operation (emergency or reset). `arrivals_per_s` is the forecast.
+int mpcChoose(const MpcConfig &config, const TimingPlan &plan, StateType state,
+              uint32_t elapsed_ms, const float queue[NUM_APPROACHES],
+              const float arrivals_per_s[NUM_APPROACHES], MpcRollouts &rollouts,
+              float &best_delay);
+
+// Runs one decision for every intersection, starting from its estimated
+// queues and using its arrival rates as the forecast, and applies the chosen
+// green times. Returns the rollouts run.
+uint64_t mpcDecide(BatchSim &sim, const MpcConfig &config, MpcRollouts &rollouts);
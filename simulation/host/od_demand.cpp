@@ -0,0 +1,294 @@
+#include "od_demand.h"
+
+#include <algorithm>
+#include <math.h>
+#include <thread>
+
+#include "batch_sim.h"
+
+const uint8_t HEADING_NORTH = 0, HEADING_EAST = 1, HEADING_SOUTH = 2, HEADING_WEST = 3;
+const float NO_COST = 1e30f;
+
+static uint32_t xorshift(uint32_t &s) {
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return s;
+}
+
+static int8_t approachForHeading(uint8_t heading) {
+  return heading == HEADING_NORTH || heading == HEADING_SOUTH ? APPROACH_NS : APPROACH_EW;
+}
+
+// --- Network ---
+void buildOdNetwork(OdAssignment &a, const OdGrid &grid, const TimingPlan &plan) {
+  uint32_t cols = grid.cols, rows = grid.rows;
+  a.intersections = cols * rows;
+  a.zones = 2 * (cols + rows);
+  float free_s = grid.link_m / grid.speed_mps;
+
+  // Zones: north ends of each column, then south ends, west ends of each row, east ends
+  std::vector<OdLink> links;
+  auto node = [cols](uint32_t r, uint32_t c) { return r * cols + c; };
+  auto add = [&](uint32_t from, uint32_t to, uint8_t heading, bool into_zone) {
+    OdLink l = { from, to, heading, (int8_t)(into_zone ? -1 : approachForHeading(heading)),
+                 free_s };
+    links.push_back(l);
+  };
+  for (uint32_t r = 0; r < rows; r++) {
+    for (uint32_t c = 0; c < cols; c++) {
+      uint32_t n = node(r, c);
+      if (r > 0) add(n, node(r - 1, c), HEADING_NORTH, false);
+      if (r + 1 < rows) add(n, node(r + 1, c), HEADING_SOUTH, false);
+      if (c > 0) add(n, node(r, c - 1), HEADING_WEST, false);
+      if (c + 1 < cols) add(n, node(r, c + 1), HEADING_EAST, false);
+    }
+  }
+  uint32_t zone = a.intersections;
+  for (uint32_t c = 0; c < cols; c++, zone++) {
+    add(zone, node(0, c), HEADING_SOUTH, false);
+    add(node(0, c), zone, HEADING_NORTH, true);
+  }
+  for (uint32_t c = 0; c < cols; c++, zone++) {
+    add(zone, node(rows - 1, c), HEADING_NORTH, false);
+    add(node(rows - 1, c), zone, HEADING_SOUTH, true);
+  }
+  for (uint32_t r = 0; r < rows; r++, zone++) {
+    add(zone, node(r, 0), HEADING_EAST, false);
+    add(node(r, 0), zone, HEADING_WEST, true);
+  }
+  for (uint32_t r = 0; r < rows; r++, zone++) {
+    add(zone, node(r, cols - 1), HEADING_WEST, false);
+    add(node(r, cols - 1), zone, HEADING_EAST, true);
+  }
+
+  // Group by origin for CSR adjacency
+  uint32_t nodes = a.intersections + a.zones;
+  std::stable_sort(links.begin(), links.end(),
+                   [](const OdLink &x, const OdLink &y) { return x.from < y.from; });
+  a.links = links;
+  a.out_start.assign(nodes + 1, 0);
+  for (size_t l = 0; l < links.size(); l++) a.out_start[links[l].from + 1]++;
+  for (uint32_t n = 0; n < nodes; n++) a.out_start[n + 1] += a.out_start[n];
+
+  // Capacity is saturation flow over the approach's share of the cycle
+  double cycle_ms = plan.ns_green_ms + plan.ew_green_ms + 2.0 * plan.yellow_ms;
+  double saturation_vph = 3600000.0 / SATURATION_HEADWAY_MS;
+  double green_ms[NUM_APPROACHES] = { (double)plan.ns_green_ms, (double)plan.ew_green_ms };
+  for (int ap = 0; ap < NUM_APPROACHES; ap++) {
+    double red_s = (cycle_ms - green_ms[ap]) / 1000.0;
+    a.approach_capacity[ap] = (float)(saturation_vph * green_ms[ap] / cycle_ms);
+    a.approach_delay_s[ap] = (float)(red_s * red_s / (2.0 * cycle_ms / 1000.0));
+  }
+
+  a.link_flow.assign(a.links.size(), 0.0f);
+  for (int ap = 0; ap < NUM_APPROACHES; ap++) a.arrivals[ap].assign(a.intersections, 0.0f);
+  a.turns.assign((size_t)a.intersections * NUM_TURNS, 0.0f);
+  a.trips = 0;
+  a.mean_cost_s = 0;
+}
+
+// --- Demand ---
+void gravityDemand(const OdAssignment &a, const OdGrid &grid, double trips_vph,
+                   double mean_trip_m, uint32_t seed, std::vector<float> &od) {
+  uint32_t z = a.zones;
+  std::vector<float> x(z), y(z), produce(z), attract(z);
+  uint32_t rng = seed ? seed : 1;
+  for (uint32_t i = 0; i < z; i++) {
+    // Zone position one link beyond its boundary intersection
+    uint32_t k = i;
+    if (k < grid.cols) {
+      x[i] = k;
+      y[i] = -1.0f;
+    } else if ((k -= grid.cols) < grid.cols) {
+      x[i] = k;
+      y[i] = grid.rows;
+    } else if ((k -= grid.cols) < grid.rows) {
+      x[i] = -1.0f;
+      y[i] = k;
+    } else {
+      k -= grid.rows;
+      x[i] = grid.cols;
+      y[i] = k;
+    }
+    produce[i] = 0.5f + (xorshift(rng) % 1000) / 1000.0f;
+    attract[i] = 0.5f + (xorshift(rng) % 1000) / 1000.0f;
+  }
+
+  od.assign((size_t)z * z, 0.0f);
+  double total = 0;
+  for (uint32_t i = 0; i < z; i++) {
+    for (uint32_t j = 0; j < z; j++) {
+      if (i == j) continue;
+      double d = (fabs(x[i] - x[j]) + fabs(y[i] - y[j])) * grid.link_m;
+      float v = (float)(produce[i] * attract[j] * exp(-d / mean_trip_m));
+      od[(size_t)i * z + j] = v;
+      total += v;
+    }
+  }
+  if (total <= 0) return;
+  float scale = (float)(trips_vph / total);
+  for (size_t k = 0; k < od.size(); k++) od[k] *= scale;
+}
+
+// --- Assignment ---
+// Per-thread scratch and partial results
+struct AssignWorker {
+  std::vector<float> dist;
+  std::vector<uint32_t> pred;        // Link into each settled node
+  std::vector<uint32_t> order;       // Nodes in settle order
+  std::vector<float> node_flow;
+  std::vector<std::pair<float, uint32_t>> heap;
+  std::vector<float> link_flow;
+  std::vector<float> turns;
+  double trips;
+  double cost;                       // Sum of trips * route cost
+};
+
+static int turnBetween(uint8_t in, uint8_t out) {
+  if (in == out) return TURN_THROUGH;
+  if (out == (in + 1) % 4) return TURN_RIGHT;
+  return TURN_LEFT;
+}
+
+// Shortest-path tree from zone `origin`, loaded with `fraction` of its OD row
+static void loadOrigin(const OdAssignment &a, const std::vector<float> &cost,
+                       const std::vector<float> &od, float fraction, uint32_t origin,
+                       AssignWorker &w) {
+  uint32_t n_int = a.intersections;
+  uint32_t source = n_int + origin;
+  const float *row = &od[(size_t)origin * a.zones];
+
+  // Only nodes the previous tree settled need clearing
+  for (size_t k = 0; k < w.order.size(); k++) {
+    w.dist[w.order[k]] = NO_COST;
+    w.node_flow[w.order[k]] = 0;
+  }
+  w.order.clear();
+  w.heap.clear();
+
+  // Min-heap on (-cost) with lazy deletion of stale entries
+  w.dist[source] = 0;
+  w.heap.push_back(std::make_pair(-0.0f, source));
+  while (!w.heap.empty()) {
+    std::pop_heap(w.heap.begin(), w.heap.end());
+    float d = -w.heap.back().first;
+    uint32_t n = w.heap.back().second;
+    w.heap.pop_back();
+    if (d > w.dist[n]) continue;
+    w.order.push_back(n);
+    if (n >= n_int && n != source) continue; // Trips end at zones, never pass through
+    for (uint32_t l = a.out_start[n]; l < a.out_start[n + 1]; l++) {
+      uint32_t to = a.links[l].to;
+      float nd = d + cost[l];
+      if (nd >= w.dist[to]) continue;
+      if (w.dist[to] == NO_COST) w.order.push_back(to); // Cleared next time even if stale
+      w.dist[to] = nd;
+      w.pred[to] = l;
+      w.heap.push_back(std::make_pair(-nd, to));
+      std::push_heap(w.heap.begin(), w.heap.end());
+    }
+  }
+
+  for (uint32_t z = 0; z < a.zones; z++) {
+    float v = row[z] * fraction;
+    if (v <= 0 || z == origin) continue;
+    uint32_t n = n_int + z;
+    if (w.dist[n] == NO_COST) continue;
+    w.node_flow[n] = v;
+    w.trips += v;
+    w.cost += (double)v * w.dist[n];
+  }
+  // A node is listed when first reached and again when settled. Walking back
+  // from the end meets every node's settled entry after all of its children;
+  // zeroing the flow once it is passed up makes the earlier entry a no-op.
+  for (size_t k = w.order.size(); k-- > 0;) {
+    uint32_t n = w.order[k];
+    float f = w.node_flow[n];
+    if (f <= 0 || n == source) continue;
+    uint32_t l = w.pred[n];
+    w.node_flow[n] = 0;
+    w.link_flow[l] += f;
+    uint32_t up = a.links[l].from;
+    w.node_flow[up] += f;
+    if (up < n_int) {
+      const OdLink &in = a.links[w.pred[up]];
+      w.turns[(size_t)up * NUM_TURNS + turnBetween(in.heading, a.links[l].heading)] += f;
+    }
+  }
+}
+
+// Signal-delayed, BPR-congested cost of each link at the current arrivals
+static void updateCosts(const OdAssignment &a, std::vector<float> &cost) {
+  for (size_t l = 0; l < a.links.size(); l++) {
+    const OdLink &link = a.links[l];
+    if (link.approach < 0) {
+      cost[l] = link.free_s;
+      continue;
+    }
+    float ratio = a.arrivals[link.approach][link.to] / a.approach_capacity[link.approach];
+    float ratio2 = ratio * ratio;
+    cost[l] = (link.free_s + a.approach_delay_s[link.approach]) *
+              (1.0f + BPR_ALPHA * powf(ratio2, BPR_BETA / 2));
+  }
+}
+
+void assignDemand(OdAssignment &a, const std::vector<float> &od, int increments,
+                  unsigned threads) {
+  uint32_t nodes = a.intersections + a.zones;
+  if (increments < 1) increments = 1;
+  if (threads < 1) threads = 1;
+  if (threads > a.zones) threads = a.zones;
+
+  std::vector<AssignWorker> workers(threads);
+  for (unsigned t = 0; t < threads; t++) {
+    AssignWorker &w = workers[t];
+    w.dist.assign(nodes, NO_COST);
+    w.pred.assign(nodes, 0);
+    w.node_flow.assign(nodes, 0.0f);
+    w.heap.reserve(a.links.size());
+    w.order.reserve(2 * nodes);
+  }
+
+  std::vector<float> cost(a.links.size());
+  std::fill(a.link_flow.begin(), a.link_flow.end(), 0.0f);
+  std::fill(a.turns.begin(), a.turns.end(), 0.0f);
+  for (int ap = 0; ap < NUM_APPROACHES; ap++)
+    std::fill(a.arrivals[ap].begin(), a.arrivals[ap].end(), 0.0f);
+  a.trips = 0;
+  double total_cost = 0;
+
+  float fraction = 1.0f / increments;
+  for (int slice = 0; slice < increments; slice++) {
+    updateCosts(a, cost);
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++) {
+      pool.push_back(std::thread([&, t]() {
+        AssignWorker &w = workers[t];
+        w.link_flow.assign(a.links.size(), 0.0f);
+        w.turns.assign(a.turns.size(), 0.0f);
+        w.trips = w.cost = 0;
+        for (uint32_t origin = t; origin < a.zones; origin += threads)
+          loadOrigin(a, cost, od, fraction, origin, w);
+      }));
+    }
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+
+    for (unsigned t = 0; t < threads; t++) {
+      const AssignWorker &w = workers[t];
+      for (size_t l = 0; l < a.link_flow.size(); l++) a.link_flow[l] += w.link_flow[l];
+      for (size_t k = 0; k < a.turns.size(); k++) a.turns[k] += w.turns[k];
+      a.trips += w.trips;
+      total_cost += w.cost;
+    }
+
+    for (int ap = 0; ap < NUM_APPROACHES; ap++)
+      std::fill(a.arrivals[ap].begin(), a.arrivals[ap].end(), 0.0f);
+    for (size_t l = 0; l < a.links.size(); l++) {
+      const OdLink &link = a.links[l];
+      if (link.approach >= 0) a.arrivals[link.approach][link.to] += a.link_flow[l];
+    }
+  }
+  a.mean_cost_s = a.trips > 0 ? total_cost / a.trips : 0;
+}
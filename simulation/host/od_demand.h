@@ -0,0 +1,80 @@
+// Origin-destination demand assigned to routes through a grid of signals.
+//
+// The network is a `cols` x `rows` grid of intersections (id = row * cols +
+// col, row 0 to the north) joined by two-way links. Every street end on the
+// boundary is a zone where trips start and end. Trips follow least-cost
+// routes: each link costs its free-flow time plus the signal delay of the
+// approach it arrives on. That delay grows with the approach's volume over
+// its capacity (saturation flow times its green share) by the BPR curve.
+//
+// Assignment is incremental: the OD matrix is loaded in `increments` slices,
+// and link costs are updated from the flows after each slice. Within a slice,
+// one shortest-path tree per origin is computed and loaded for all of that
+// origin's destinations. The subtree sums are accumulated in reverse settle
+// order, so loading costs O(nodes) per origin, not O(pairs x path length).
+// Origins are split across threads with private flow arrays, which are
+// summed after each slice.
+//
+// The result is each intersection's NS and EW arrivals per hour, ready for
+// BatchSim's rate arrays, plus the turning movements the routes make.
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "controller.h"
+#include "rollup.h"
+
+const float BPR_ALPHA = 0.15f;
+const float BPR_BETA = 4.0f;
+
+enum TurnMovement {
+  TURN_THROUGH,
+  TURN_LEFT,
+  TURN_RIGHT,
+  NUM_TURNS
+};
+
+struct OdGrid {
+  uint32_t cols;
+  uint32_t rows;
+  float link_m;
+  float speed_mps;          // Free-flow speed
+};
+
+// Directed link between graph nodes: intersections first, then zones
+struct OdLink {
+  uint32_t from;
+  uint32_t to;
+  uint8_t heading;          // 0 north, 1 east, 2 south, 3 west
+  int8_t approach;          // APPROACH_* at `to`, -1 into a zone
+  float free_s;
+};
+
+struct OdAssignment {
+  uint32_t intersections;
+  uint32_t zones;           // 2 * (cols + rows): north, south, west, east street ends
+  std::vector<OdLink> links;
+  std::vector<uint32_t> out_start;   // CSR: links leaving node n are [out_start[n], out_start[n+1])
+  float approach_capacity[NUM_APPROACHES]; // Vehicles per hour per intersection
+  float approach_delay_s[NUM_APPROACHES];  // Mean red wait when uncongested
+
+  // Results, vehicles per hour
+  std::vector<float> link_flow;
+  std::vector<float> arrivals[NUM_APPROACHES]; // Per intersection
+  std::vector<float> turns;          // intersections * NUM_TURNS
+  double trips;
+  double mean_cost_s;                // Trip-weighted route cost, at the costs each slice saw
+};
+
+// Builds the grid graph. Capacities follow `plan`'s green split.
+void buildOdNetwork(OdAssignment &a, const OdGrid &grid, const TimingPlan &plan);
+
+// Gravity-model OD matrix (zones x zones, vehicles per hour) totalling
+// `trips_vph`: random zone weights, deterred by exp(-distance / mean_trip_m)
+void gravityDemand(const OdAssignment &a, const OdGrid &grid, double trips_vph,
+                   double mean_trip_m, uint32_t seed, std::vector<float> &od);
+
+// Incremental assignment of `od` in `increments` slices on `threads` threads
+void assignDemand(OdAssignment &a, const std::vector<float> &od, int increments,
+                  unsigned threads);
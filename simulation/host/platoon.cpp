@@ -0,0 +1,70 @@
+#include "platoon.h"
+
+#include <string.h>
+
+void initPlatoonTracker(PlatoonTracker &t) {
+  memset(&t, 0, sizeof(t));
+}
+
+void platoonLoopEdge(PlatoonTracker &t, bool occupied, uint32_t now_ms,
+                     const PlatoonConfig &config) {
+  if (occupied) {
+    bool joins = t.size > 0 && now_ms - t.on_ms <= PLATOON_HEADWAY_MS;
+    t.size = joins ? t.size + 1 : 1;
+    t.on_ms = now_ms;
+    return;
+  }
+
+  // Leaving the loop: speed from occupancy, then time to the stop line
+  uint32_t held_ms = now_ms - t.on_ms;
+  float speed = held_ms > 0 ? config.effective_length_m * 1000.0f / held_ms : config.min_speed;
+  if (speed < config.min_speed) speed = config.min_speed;
+  uint32_t arrive = t.on_ms + (uint32_t)(config.loop_distance_m * 1000.0f / speed);
+  if (t.size == 1) t.arrive_first_ms = arrive;
+  t.arrive_last_ms = arrive;
+  if (t.size == PLATOON_MIN_VEHICLES) t.platoons++;
+}
+
+bool platoonDue(const PlatoonTracker &t, uint32_t now_ms, uint32_t within_ms) {
+  if (t.size < PLATOON_MIN_VEHICLES) return false;
+  // Signed differences so the window survives clock wrap
+  bool cleared = (int32_t)(t.arrive_last_ms + PLATOON_HEADWAY_MS - now_ms) < 0;
+  bool near = (int32_t)(t.arrive_first_ms - now_ms) <= (int32_t)within_ms;
+  return !cleared && near;
+}
+
+uint8_t platoonInputs(const ControllerState &c, uint8_t inputs, uint32_t now_ms,
+                      const TimingPlan &plan, const PlatoonTracker lanes[4],
+                      PlatoonAction &action) {
+  action = PLATOON_NONE;
+  if (inputs & (IN_EMERGENCY | IN_RESET)) return inputs;
+
+  bool ns = c.current_state == NS_GREEN;
+  bool ew = c.current_state == EW_GREEN;
+  if (!ns && !ew) return inputs;
+
+  uint32_t elapsed = now_ms - (uint32_t)c.stateStartTime;
+  uint32_t green = ns ? plan.ns_green_ms : plan.ew_green_ms;
+  const PlatoonTracker *own = ns ? &lanes[0] : &lanes[2];
+  const PlatoonTracker *other = ns ? &lanes[2] : &lanes[0];
+  uint8_t conflicting = ns ? IN_EW_ANY : IN_NS_ANY;
+
+  // Hold: a platoon for this green arrives before the extension runs out
+  if (elapsed >= green && elapsed < green + PLATOON_MAX_HOLD_MS && (inputs & conflicting)) {
+    uint32_t left = green + PLATOON_MAX_HOLD_MS - elapsed;
+    if (platoonDue(own[0], now_ms, left) || platoonDue(own[1], now_ms, left)) {
+      action = PLATOON_HOLD;
+      return inputs & ~conflicting;
+    }
+  }
+
+  // Early call: the red approach's platoon lands within the change interval
+  uint32_t lead = plan.yellow_ms + PLATOON_CALL_LEAD_MS;
+  bool own_due = platoonDue(own[0], now_ms, lead) || platoonDue(own[1], now_ms, lead);
+  if (!(inputs & conflicting) && !own_due &&
+      (platoonDue(other[0], now_ms, lead) || platoonDue(other[1], now_ms, lead))) {
+    action = PLATOON_CALL;
+    return inputs | (ns ? IN_EW1 : IN_NS1);
+  }
+  return inputs;
+}
@@ -0,0 +1,58 @@
+// Platoon detection at advance loops and the green hold / early call built on it.
+//
+// Each approach lane's advance loop reports on/off edges. Vehicles whose
+// rising edges follow each other within PLATOON_HEADWAY_MS form a platoon;
+// once it reaches PLATOON_MIN_VEHICLES it is confirmed. Each vehicle's speed
+// comes from how long it held the loop, which gives its arrival time at the
+// stop line, so a tracker always knows the window in which its current
+// platoon will reach the intersection. All updates are O(1) per edge.
+//
+// platoonInputs() turns the windows into demand for the unchanged FSM: a
+// green whose platoon is about to arrive is held by hiding the conflicting
+// calls (for at most PLATOON_MAX_HOLD_MS past its planned green), and a red
+// approach with a platoon due within the change interval is called early.
+#pragma once
+
+#include <stdint.h>
+
+#include "controller.h"
+
+const uint32_t PLATOON_HEADWAY_MS = 3500;   // Largest gap between vehicles of one platoon
+const uint16_t PLATOON_MIN_VEHICLES = 3;
+const uint32_t PLATOON_MAX_HOLD_MS = 8000;  // Green extension limit
+const uint32_t PLATOON_CALL_LEAD_MS = 2000; // Early call margin beyond the yellow
+
+struct PlatoonConfig {
+  float loop_distance_m;    // Advance loop to stop line
+  float effective_length_m; // Vehicle plus loop length, for speed from occupancy
+  float min_speed;          // Floor for the speed estimate of a crawling vehicle
+};
+
+struct PlatoonTracker {
+  uint32_t on_ms;           // Rising edge of the vehicle on the loop
+  uint16_t size;            // Vehicles in the current platoon so far
+  uint32_t arrive_first_ms; // Predicted stop-line arrival of its first vehicle
+  uint32_t arrive_last_ms;  // ... and of its latest one
+  uint32_t platoons;        // Confirmed platoons since start
+};
+
+enum PlatoonAction : uint8_t {
+  PLATOON_NONE,
+  PLATOON_HOLD,             // Conflicting calls hidden to keep the green
+  PLATOON_CALL              // Red approach called ahead of its platoon
+};
+
+void initPlatoonTracker(PlatoonTracker &t);
+
+void platoonLoopEdge(PlatoonTracker &t, bool occupied, uint32_t now_ms,
+                     const PlatoonConfig &config);
+
+// True when a confirmed platoon has not yet cleared the stop line and its
+// first vehicle arrives within `within_ms`
+bool platoonDue(const PlatoonTracker &t, uint32_t now_ms, uint32_t within_ms);
+
+// Inputs the FSM should step on. `lanes` holds the trackers of one
+// intersection in IN_NS1..IN_EW2 order.
+uint8_t platoonInputs(const ControllerState &c, uint8_t inputs, uint32_t now_ms,
+                      const TimingPlan &plan, const PlatoonTracker lanes[4],
+                      PlatoonAction &action);
@@ -0,0 +1,270 @@
+// pty_device: the host-built sketch presented as a virtual serial device.
+//
+// Serial output appears on a pseudo-terminal exactly as the board would send
+// it, paced byte by byte at the configured baud rate. The sketch runs on a
+// virtual clock that can be sped up (-x), so a log collector attached to the
+// pty sees hours of controller output in minutes. Like the ATmega's 64-byte
+// TX buffer, Serial.print() "blocks" when the line is saturated: virtual
+// time advances until a byte has been shifted out.
+//
+// Bytes written to the pty reach the sketch's Serial RX buffer at the same
+// baud rate, so its console (Serial.read()) can be driven like a board's.
+// Bytes the full RX buffer cannot take wait in the pty instead of being lost.
+//
+// Pin stimulus arrives as text datagrams on a UNIX socket (-i), one command
+// per line: "<pin> <0|1>", e.g. "3 0" asserts the active-low emergency input.
+//
+// Usage: pty_device [-b baud] [-x speed] [-i stimulus_socket] [-l symlink]
+//   -x 0 runs as fast as possible; -x 1 is real time (default).
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arduino_shim.h"
+
+const unsigned long TX_BUFFER_SIZE = SERIAL_TX_BUFFER_SIZE;
+const unsigned long long LOOP_STEP_US = 1000; // Virtual time per loop() call
+const size_t PENDING_CAPACITY = 1 << 16;
+
+// --- Device State ---
+static int master_fd = -1;
+static unsigned long long byte_time_ns; // 10 bits per byte (8N1)
+static unsigned long long virtual_ns = 0;
+
+// Bytes still on the "wire": each one has the virtual time it finishes sending
+static char pending_data[PENDING_CAPACITY];
+static unsigned long long pending_done_ns[PENDING_CAPACITY];
+static size_t pending_head = 0, pending_tail = 0;
+static unsigned long long line_free_ns = 0; // When the UART finishes its last byte
+static unsigned long long rx_due_ns = 0;    // When the next received byte completes
+
+static unsigned long long bytes_sent = 0;
+static unsigned long long bytes_dropped = 0; // Nobody reading the pty
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void onSignal(int) { stop_requested = 1; }
+
+static unsigned long long monotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static size_t pendingCount() { return pending_tail - pending_head; }
+
+static void advanceVirtual(unsigned long long ns) {
+  // shim clock is in microseconds; keep the remainder here
+  unsigned long long before_us = virtual_ns / 1000;
+  virtual_ns += ns;
+  shimAdvanceMicros(virtual_ns / 1000 - before_us);
+}
+
+// Writes every byte whose transmission has completed in virtual time
+static void drainToPty() {
+  char out[4096];
+  size_t len = 0;
+  while (pendingCount() > 0 && len < sizeof(out) &&
+         pending_done_ns[pending_head % PENDING_CAPACITY] <= virtual_ns) {
+    out[len++] = pending_data[pending_head % PENDING_CAPACITY];
+    pending_head++;
+  }
+  if (len == 0) return;
+  ssize_t n = write(master_fd, out, len);
+  if (n < 0) n = 0;
+  bytes_sent += n;
+  bytes_dropped += len - n;
+}
+
+// Bytes handed to the UART that have not finished sending
+static unsigned long inFlight() {
+  unsigned long in_flight = 0;
+  for (size_t j = pending_head; j < pending_tail; j++) {
+    if (pending_done_ns[j % PENDING_CAPACITY] > virtual_ns) in_flight++;
+  }
+  return in_flight;
+}
+
+// availableForWrite(): TX buffer slots print() can fill without waiting
+static int uartRoom() {
+  unsigned long in_flight = inFlight();
+  return in_flight < TX_BUFFER_SIZE ? (int)(TX_BUFFER_SIZE - in_flight) : 0;
+}
+
+// Serial sink: schedules each byte on the virtual UART
+static void serialToUart(const char *data, unsigned long len) {
+  for (unsigned long i = 0; i < len; i++) {
+    // Bytes not yet sent beyond the TX buffer make print() wait
+    while (pendingCount() > 0) {
+      if (inFlight() < TX_BUFFER_SIZE && pendingCount() < PENDING_CAPACITY) break;
+      advanceVirtual(byte_time_ns);
+      drainToPty();
+    }
+
+    unsigned long long start = line_free_ns > virtual_ns ? line_free_ns : virtual_ns;
+    line_free_ns = start + byte_time_ns;
+    pending_data[pending_tail % PENDING_CAPACITY] = data[i];
+    pending_done_ns[pending_tail % PENDING_CAPACITY] = line_free_ns;
+    pending_tail++;
+  }
+}
+
+// Moves the bytes that have finished arriving from the pty into the RX buffer
+static void receiveFromPty() {
+  unsigned long long arrived =
+      virtual_ns >= rx_due_ns ? (virtual_ns - rx_due_ns) / byte_time_ns + 1 : 0;
+  size_t want = shimSerialRxFree();
+  if (arrived < want) want = arrived;
+  if (want == 0) return;
+
+  char in[SERIAL_RX_BUFFER_SIZE];
+  ssize_t n = read(master_fd, in, want);
+  if (n <= 0) {
+    // Idle line: the next byte written takes a full byte time from now
+    rx_due_ns = virtual_ns + byte_time_ns;
+    return;
+  }
+  shimReceiveSerial(in, n);
+  rx_due_ns += n * byte_time_ns;
+}
+
+// Applies every queued "<pin> <level>" command
+static void readStimulus(int fd) {
+  char text[512];
+  while (true) {
+    ssize_t n = recv(fd, text, sizeof(text) - 1, MSG_DONTWAIT);
+    if (n <= 0) return;
+    text[n] = '\0';
+    char *save = NULL;
+    for (char *line = strtok_r(text, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+      int pin, level;
+      if (sscanf(line, "%d %d", &pin, &level) == 2) shimSetPin(pin, level);
+    }
+  }
+}
+
+static int openStimulusSocket(const char *path) {
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path);
+  if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int openPty() {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) return -1;
+
+  // Raw mode so "\r\n" reaches the reader unchanged
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  return fd;
+}
+
+int main(int argc, char **argv) {
+  unsigned long baud = 9600;
+  double speed = 1.0;
+  const char *stimulus_path = NULL;
+  const char *link_path = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "b:x:i:l:")) != -1) {
+    switch (opt) {
+      case 'b': baud = strtoul(optarg, NULL, 10); break;
+      case 'x': speed = atof(optarg); break;
+      case 'i': stimulus_path = optarg; break;
+      case 'l': link_path = optarg; break;
+      default:
+        fprintf(stderr, "Usage: %s [-b baud] [-x speed] [-i stimulus_socket] [-l symlink]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+  if (baud == 0 || speed < 0) {
+    fprintf(stderr, "Baud must be positive and speed non-negative\n");
+    return 1;
+  }
+  byte_time_ns = 10ULL * 1000000000ULL / baud;
+
+  master_fd = openPty();
+  if (master_fd < 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+  const char *slave = ptsname(master_fd);
+  if (link_path) {
+    unlink(link_path);
+    if (symlink(slave, link_path) != 0) perror("symlink");
+  }
+
+  int stimulus_fd = -1;
+  if (stimulus_path) {
+    stimulus_fd = openStimulusSocket(stimulus_path);
+    if (stimulus_fd < 0) {
+      perror("stimulus socket");
+      return 1;
+    }
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("pty_device: serial on %s at %lu baud, speed x%g\n", slave, baud, speed);
+  fflush(stdout);
+
+  shimUseVirtualClock();
+  shimSetSerialSink(serialToUart);
+  shimSetSerialRoom(uartRoom);
+  setup();
+
+  unsigned long long real_start = monotonicNs();
+  unsigned long long virtual_start = virtual_ns;
+  while (!stop_requested) {
+    if (stimulus_fd >= 0) readStimulus(stimulus_fd);
+
+    receiveFromPty();
+    loop();
+    // delay() inside loop() moves only the shim clock; catch up with it
+    unsigned long long shim_ns = (unsigned long long)micros() * 1000ULL;
+    if (shim_ns > virtual_ns) virtual_ns = shim_ns;
+    advanceVirtual(LOOP_STEP_US * 1000ULL);
+    drainToPty();
+
+    // Sleep only once virtual time is a millisecond or more ahead of real time
+    if (speed > 0) {
+      unsigned long long target =
+          real_start + (unsigned long long)((virtual_ns - virtual_start) / speed);
+      unsigned long long now = monotonicNs();
+      if (target > now + 1000000ULL) {
+        struct timespec ts;
+        ts.tv_sec = target / 1000000000ULL;
+        ts.tv_nsec = target % 1000000000ULL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+      }
+    }
+  }
+
+  fprintf(stderr, "pty_device: %llu bytes sent, %llu dropped, %.3f s virtual time\n",
+          bytes_sent, bytes_dropped, virtual_ns / 1e9);
+  if (link_path) unlink(link_path);
+  if (stimulus_path) unlink(stimulus_path);
+  return 0;
+}
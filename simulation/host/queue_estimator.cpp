@@ -0,0 +1,43 @@
+#include "queue_estimator.h"
+
+const QueueEstimatorConfig DEFAULT_QUEUE_ESTIMATOR = {
+  0.05f, // 5% of counts wrong
+  0.01f, // A clear stop bar is close to certain
+  0.5f,
+  8.0f   // Advance detector ~55 m upstream, 7 m per queued vehicle
+};
+
+// Kalman update with a direct measurement of the queue
+static void measure(QueueEstimate &e, float z, float r) {
+  float gain = e.variance / (e.variance + r);
+  e.queue += gain * (z - e.queue);
+  e.variance *= 1.0f - gain;
+}
+
+void queueArrival(QueueEstimate &e, const QueueEstimatorConfig &config) {
+  e.queue += 1.0f;
+  e.variance += config.count_variance;
+}
+
+void queueDeparture(QueueEstimate &e, const QueueEstimatorConfig &config) {
+  e.queue -= 1.0f;
+  if (e.queue < 0) e.queue = 0;
+  e.variance += config.count_variance;
+}
+
+void queueStopbarEdge(QueueEstimate &e, bool occupied, const QueueEstimatorConfig &config) {
+  if (!occupied) {
+    measure(e, 0.0f, config.exact_variance);
+  } else if (e.queue < 1.0f) {
+    measure(e, 1.0f, config.bound_variance);
+  }
+}
+
+void queueAdvanceEdge(QueueEstimate &e, bool occupied, const QueueEstimatorConfig &config) {
+  // Occupied: the queue reaches the detector. Released: it has dropped below it.
+  if (occupied && e.queue < config.advance_vehicles) {
+    measure(e, config.advance_vehicles, config.bound_variance);
+  } else if (!occupied && e.queue > config.advance_vehicles) {
+    measure(e, config.advance_vehicles - 1.0f, config.bound_variance);
+  }
+}
@@ -0,0 +1,42 @@
+// Queue-length estimation from detector events.
+//
+// The controller only sees "demand / no demand". This keeps a running
+// estimate of how many vehicles wait on an approach by input-output
+// counting (advance detector counts arrivals, stop-bar detector counts
+// departures), with a scalar Kalman filter that grows the uncertainty with
+// every count and corrects it whenever a detector state pins the queue:
+// the stop bar clearing means the queue is empty, the stop bar occupied
+// means at least one vehicle, and a queue standing over the advance
+// detector means at least advance_vehicles. Every update is O(1).
+#pragma once
+
+#include <stdint.h>
+
+struct QueueEstimatorConfig {
+  float count_variance;    // Variance added per counted vehicle (missed or double counts)
+  float exact_variance;    // Measurement noise when the stop bar clears
+  float bound_variance;    // Measurement noise of a "queue at least / at most" observation
+  float advance_vehicles;  // Vehicles between the stop bar and the advance detector
+};
+
+extern const QueueEstimatorConfig DEFAULT_QUEUE_ESTIMATOR;
+
+// All zero is an empty, certain queue (the state of a fresh arena)
+struct QueueEstimate {
+  float queue;             // Estimated vehicles waiting
+  float variance;
+};
+
+// A vehicle counted by the advance detector
+void queueArrival(QueueEstimate &e, const QueueEstimatorConfig &config);
+// A vehicle counted crossing the stop bar
+void queueDeparture(QueueEstimate &e, const QueueEstimatorConfig &config);
+// Stop-bar presence changed
+void queueStopbarEdge(QueueEstimate &e, bool occupied, const QueueEstimatorConfig &config);
+// Advance detector held occupied by a standing queue (true), or released (false)
+void queueAdvanceEdge(QueueEstimate &e, bool occupied, const QueueEstimatorConfig &config);
+
+// Vehicles, rounded, for timing logic and telemetry
+inline uint16_t queueVehicles(const QueueEstimate &e) {
+  return e.queue <= 0 ? 0 : (uint16_t)(e.queue + 0.5f);
+}
@@ -0,0 +1,174 @@
+#include "rollup.h"
+
+#include <string.h>
+
+static RollupCell *levelCells(RollupCube &cube, int level) {
+  switch (level) {
+    case ROLLUP_MINUTE: return cube.minute;
+    case ROLLUP_HOUR: return cube.hour;
+    default: return cube.day;
+  }
+}
+
+static const RollupCell *levelCells(const RollupCube &cube, int level) {
+  return levelCells(const_cast<RollupCube &>(cube), level);
+}
+
+// Cell for `period`, cleared first if it still holds an older period
+static RollupCell &cellFor(RollupCube &cube, int level, uint32_t period) {
+  RollupCell &cell = levelCells(cube, level)[period % ROLLUP_CELLS[level]];
+  if (cell.period != period) {
+    memset(&cell, 0, sizeof(cell));
+    cell.period = period;
+  }
+  return cell;
+}
+
+static int waitBucket(unsigned long wait_ms) {
+  int bucket = 0;
+  unsigned long limit = WAIT_BUCKET_BASE_MS;
+  while (wait_ms >= limit && bucket < WAIT_BUCKETS - 1) {
+    limit <<= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+void initRollupCube(RollupCube &cube) {
+  memset(&cube, 0, sizeof(cube));
+  for (int level = 0; level < NUM_ROLLUP_LEVELS; level++) {
+    RollupCell *cells = levelCells(cube, level);
+    for (int i = 0; i < ROLLUP_CELLS[level]; i++) cells[i].period = ROLLUP_EMPTY_PERIOD;
+  }
+}
+
+void initRollupTracker(RollupTracker &tracker, unsigned long now) {
+  memset(&tracker, 0, sizeof(tracker));
+  tracker.state = INIT;
+  tracker.state_since = now;
+}
+
+// Adds [from, to) of `state` to every level, split at period boundaries.
+// Only the ROLLUP_CELLS[level] periods ending with the current one are
+// credited: an older period shares a ring slot with a newer one, and writing
+// it would clear cells already holding this period's events.
+static void creditDwell(RollupCube &cube, uint8_t state, unsigned long from, unsigned long to) {
+  for (int level = 0; level < NUM_ROLLUP_LEVELS; level++) {
+    unsigned long period_ms = ROLLUP_PERIOD_MS[level];
+    uint32_t last = (uint32_t)((to - 1) / period_ms);
+    uint32_t oldest = last >= (uint32_t)ROLLUP_CELLS[level] ? last - ROLLUP_CELLS[level] + 1 : 0;
+    unsigned long t = from;
+    if (t < (unsigned long)oldest * period_ms) t = (unsigned long)oldest * period_ms;
+
+    uint32_t first = (uint32_t)(t / period_ms);
+    if (first == last) {
+      cellFor(cube, level, first).state_ms[state] += (uint32_t)(to - t);
+      continue;
+    }
+    cellFor(cube, level, first).state_ms[state] += (uint32_t)((first + 1) * period_ms - t);
+    for (uint32_t period = first + 1; period < last; period++) {
+      cellFor(cube, level, period).state_ms[state] += (uint32_t)period_ms;
+    }
+    cellFor(cube, level, last).state_ms[state] += (uint32_t)(to - (unsigned long)last * period_ms);
+  }
+}
+
+static bool approachHasGreen(uint8_t state, int approach) {
+  if (approach == APPROACH_NS) return state == NS_GREEN || state == EMERGENCY_GREEN;
+  return state == EW_GREEN;
+}
+
+static void recordWait(RollupCube &cube, int approach, unsigned long wait_ms, unsigned long now) {
+  int bucket = waitBucket(wait_ms);
+  for (int level = 0; level < NUM_ROLLUP_LEVELS; level++) {
+    uint32_t period = (uint32_t)(now / ROLLUP_PERIOD_MS[level]);
+    cellFor(cube, level, period).wait_hist[approach][bucket]++;
+  }
+}
+
+void rollupFlush(RollupCube &cube, RollupTracker &tracker, unsigned long now) {
+  if (now <= tracker.state_since) return;
+  creditDwell(cube, tracker.state, tracker.state_since, now);
+  tracker.state_since = now;
+}
+
+void rollupInputs(RollupCube &cube, RollupTracker &tracker, uint8_t inputs, unsigned long now) {
+  const uint8_t masks[NUM_APPROACHES] = { IN_NS_ANY, IN_EW_ANY };
+  for (int a = 0; a < NUM_APPROACHES; a++) {
+    bool was = (tracker.inputs & masks[a]) != 0;
+    bool is = (inputs & masks[a]) != 0;
+    if (is && !was) {
+      for (int level = 0; level < NUM_ROLLUP_LEVELS; level++) {
+        uint32_t period = (uint32_t)(now / ROLLUP_PERIOD_MS[level]);
+        cellFor(cube, level, period).demand_count[a]++;
+      }
+      // Demand arriving on a green is served at once
+      if (approachHasGreen(tracker.state, a)) {
+        recordWait(cube, a, 0, now);
+      } else if (!tracker.waiting[a]) {
+        tracker.waiting[a] = true;
+        tracker.demand_since[a] = now;
+      }
+    }
+  }
+  tracker.inputs = inputs;
+}
+
+void rollupTransition(RollupCube &cube, RollupTracker &tracker, StateType to, unsigned long now) {
+  rollupFlush(cube, tracker, now);
+  for (int level = 0; level < NUM_ROLLUP_LEVELS; level++) {
+    uint32_t period = (uint32_t)(now / ROLLUP_PERIOD_MS[level]);
+    cellFor(cube, level, period).transitions++;
+  }
+  tracker.state = to;
+
+  for (int a = 0; a < NUM_APPROACHES; a++) {
+    if (tracker.waiting[a] && approachHasGreen(to, a)) {
+      recordWait(cube, a, now - tracker.demand_since[a], now);
+      tracker.waiting[a] = false;
+    }
+  }
+}
+
+void mergeRollupCell(RollupCell &into, const RollupCell &from) {
+  for (int s = 0; s < NUM_STATES; s++) into.state_ms[s] += from.state_ms[s];
+  into.transitions += from.transitions;
+  for (int a = 0; a < NUM_APPROACHES; a++) {
+    into.demand_count[a] += from.demand_count[a];
+    for (int b = 0; b < WAIT_BUCKETS; b++) into.wait_hist[a][b] += from.wait_hist[a][b];
+  }
+}
+
+void mergeRollupCube(RollupCube &into, const RollupCube &from) {
+  for (int level = 0; level < NUM_ROLLUP_LEVELS; level++) {
+    const RollupCell *src = levelCells(from, level);
+    RollupCell *dst = levelCells(into, level);
+    for (int i = 0; i < ROLLUP_CELLS[level]; i++) {
+      if (src[i].period == ROLLUP_EMPTY_PERIOD) continue;
+      // A slot keeps whichever period is newer
+      if (dst[i].period == ROLLUP_EMPTY_PERIOD || dst[i].period < src[i].period) {
+        dst[i] = src[i];
+      } else if (dst[i].period == src[i].period) {
+        mergeRollupCell(dst[i], src[i]);
+      }
+    }
+  }
+}
+
+const RollupCell *rollupCell(const RollupCube &cube, RollupLevel level, uint32_t period) {
+  const RollupCell &cell = levelCells(cube, level)[period % ROLLUP_CELLS[level]];
+  return cell.period == period ? &cell : NULL;
+}
+
+uint32_t rollupWaitPercentile(const RollupCell &cell, int approach, double fraction) {
+  uint32_t total = 0;
+  for (int b = 0; b < WAIT_BUCKETS; b++) total += cell.wait_hist[approach][b];
+  if (total == 0) return 0;
+  uint32_t target = (uint32_t)(total * fraction);
+  uint32_t seen = 0;
+  for (int b = 0; b < WAIT_BUCKETS; b++) {
+    seen += cell.wait_hist[approach][b];
+    if (seen > target) return WAIT_BUCKET_BASE_MS << b;
+  }
+  return WAIT_BUCKET_BASE_MS << (WAIT_BUCKETS - 1);
+}
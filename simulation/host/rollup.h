@@ -0,0 +1,79 @@
+// Per-minute, per-hour and per-day statistics cubes for one or more
+// intersections.
+//
+// Each cell holds additive counters only (time per state, demand arrivals,
+// log-scale wait histograms), so cells from different intersections or
+// periods merge by addition in any order. Transitions, demand arrivals and
+// waits update the current cell of every level, O(1) per event. A dwell is
+// credited when it ends, to each period it overlaps that the ring still
+// keeps. That is O(1) for dwells shorter than a minute, but a dwell of a day
+// or more writes up to 1440 + 168 + 366 cells in the event that ends it.
+#pragma once
+
+#include <stdint.h>
+
+#include "controller.h"
+
+// Approaches
+const int APPROACH_NS = 0;
+const int APPROACH_EW = 1;
+const int NUM_APPROACHES = 2;
+
+// Wait bucket k holds waits in [WAIT_BUCKET_BASE_MS << (k - 1), WAIT_BUCKET_BASE_MS << k);
+// bucket 0 holds everything shorter than WAIT_BUCKET_BASE_MS
+const int WAIT_BUCKETS = 20;
+const uint32_t WAIT_BUCKET_BASE_MS = 128;
+
+// RollupCell.period of a slot that has never been written
+const uint32_t ROLLUP_EMPTY_PERIOD = ~0U;
+
+struct RollupCell {
+  uint32_t period;                            // Minute/hour/day number the cell holds
+  uint32_t state_ms[NUM_STATES];              // Time spent in each state
+  uint32_t transitions;
+  uint32_t demand_count[NUM_APPROACHES];      // Rising edges of approach demand
+  uint32_t wait_hist[NUM_APPROACHES][WAIT_BUCKETS]; // Demand onset to green
+};
+
+enum RollupLevel {
+  ROLLUP_MINUTE,
+  ROLLUP_HOUR,
+  ROLLUP_DAY,
+  NUM_ROLLUP_LEVELS
+};
+
+const uint32_t ROLLUP_PERIOD_MS[NUM_ROLLUP_LEVELS] = { 60000UL, 3600000UL, 86400000UL };
+// Cells kept per level: one day of minutes, one week of hours, one year of days
+const int ROLLUP_CELLS[NUM_ROLLUP_LEVELS] = { 1440, 168, 366 };
+
+struct RollupCube {
+  RollupCell minute[1440];
+  RollupCell hour[168];
+  RollupCell day[366];
+};
+
+// Event-side state of one intersection feeding a cube
+struct RollupTracker {
+  uint8_t state;
+  uint8_t inputs;
+  unsigned long state_since;
+  unsigned long demand_since[NUM_APPROACHES];
+  bool waiting[NUM_APPROACHES];
+};
+
+void initRollupCube(RollupCube &cube);
+void initRollupTracker(RollupTracker &tracker, unsigned long now);
+
+void rollupInputs(RollupCube &cube, RollupTracker &tracker, uint8_t inputs, unsigned long now);
+void rollupTransition(RollupCube &cube, RollupTracker &tracker, StateType to, unsigned long now);
+// Credits the current state's dwell up to `now` so queries see it
+void rollupFlush(RollupCube &cube, RollupTracker &tracker, unsigned long now);
+
+void mergeRollupCell(RollupCell &into, const RollupCell &from);
+void mergeRollupCube(RollupCube &into, const RollupCube &from);
+
+// Cell holding `period` at `level`, or NULL if it has been overwritten or never written
+const RollupCell *rollupCell(const RollupCube &cube, RollupLevel level, uint32_t period);
+
+// Upper bound of the bucket containing the `fraction` quantile of waits, in ms
+uint32_t rollupWaitPercentile(const RollupCell &cell, int approach, double fraction);
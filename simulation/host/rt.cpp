@@ -0,0 +1,87 @@
+#include "rt.h"
+
+#include <alloca.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+
+bool enterRealtime(const RealtimeOptions &options) {
+  if (options.cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(options.cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+      perror("sched_setaffinity");
+      return false;
+    }
+  }
+
+  if (options.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    perror("mlockall");
+    return false;
+  }
+
+  // Touch the stack now so the periodic loop never takes a page fault on it
+  if (options.prefault_stack > 0) {
+    volatile char *stack = (volatile char *)alloca(options.prefault_stack);
+    for (unsigned long i = 0; i < options.prefault_stack; i += 4096) stack[i] = 0;
+  }
+
+  if (options.fifo_priority > 0) {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = options.fifo_priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+      perror("sched_setscheduler");
+      return false;
+    }
+  }
+  return true;
+}
+
+void initJitter(JitterHistogram &h, long long budget_ns) {
+  memset(&h, 0, sizeof(h));
+  h.budget_ns = budget_ns;
+}
+
+void recordJitter(JitterHistogram &h, long long late_ns) {
+  if (late_ns < 0) late_ns = 0;
+  long long us = late_ns / 1000;
+  if (us < JITTER_BUCKETS) {
+    h.counts[us]++;
+  } else {
+    h.overflow++;
+  }
+  if (late_ns > h.budget_ns) h.over_budget++;
+  if (late_ns > h.max_ns) h.max_ns = late_ns;
+  h.samples++;
+}
+
+long long jitterPercentile(const JitterHistogram &h, double fraction) {
+  unsigned long long target = (unsigned long long)(h.samples * fraction);
+  unsigned long long seen = 0;
+  for (int i = 0; i < JITTER_BUCKETS; i++) {
+    seen += h.counts[i];
+    if (seen > target) return i;
+  }
+  return JITTER_BUCKETS;
+}
+
+void printJitter(const JitterHistogram &h, FILE *out) {
+  fprintf(out, "periods: %llu, late > %lld us: %llu, max %lld us\n", h.samples,
+          h.budget_ns / 1000, h.over_budget, h.max_ns / 1000);
+  if (h.samples == 0) return;
+  fprintf(out, "lateness p50 %lld us, p99 %lld us, p99.9 %lld us\n", jitterPercentile(h, 0.5),
+          jitterPercentile(h, 0.99), jitterPercentile(h, 0.999));
+
+  // Coarse bands keep the report short; the 1 us buckets back the percentiles
+  static const int BANDS[] = { 10, 20, 50, 100, 200, 500, JITTER_BUCKETS };
+  int low = 0;
+  for (unsigned b = 0; b < sizeof(BANDS) / sizeof(BANDS[0]); b++) {
+    unsigned long long count = 0;
+    for (int i = low; i < BANDS[b]; i++) count += h.counts[i];
+    fprintf(out, "  %4d-%-4d us: %llu\n", low, BANDS[b] - 1, count);
+    low = BANDS[b];
+  }
+  fprintf(out, "  >=%-7d us: %llu\n", JITTER_BUCKETS, h.overflow);
+}
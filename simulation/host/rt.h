@@ -0,0 +1,41 @@
+// Real-time execution helpers for host drivers of the sketch.
+//
+// Linux can delay a periodic loop by milliseconds when the thread migrates
+// between CPUs, is preempted by normal tasks or page-faults on first touch.
+// enterRealtime() removes those sources; JitterHistogram records how late
+// each period actually started so a run can prove its deadlines were met.
+#pragma once
+
+#include <stdio.h>
+
+struct RealtimeOptions {
+  int cpu;                     // CPU to pin to, -1 to leave unpinned
+  int fifo_priority;           // SCHED_FIFO priority 1-99, 0 to keep SCHED_OTHER
+  bool lock_memory;            // mlockall() current and future pages
+  unsigned long prefault_stack; // Bytes of stack to touch up front
+};
+
+const RealtimeOptions DEFAULT_REALTIME = { -1, 0, false, 256 * 1024 };
+
+// Applies the options to the calling thread. Prints the failing step and
+// returns false if one could not be applied (usually missing CAP_SYS_NICE
+// or CAP_IPC_LOCK).
+bool enterRealtime(const RealtimeOptions &options);
+
+// Wake-up lateness in 1 us buckets up to JITTER_BUCKETS us, plus overflow
+const int JITTER_BUCKETS = 1000;
+
+struct JitterHistogram {
+  unsigned long long counts[JITTER_BUCKETS];
+  unsigned long long overflow;    // Samples at or above JITTER_BUCKETS us
+  unsigned long long samples;
+  unsigned long long over_budget; // Samples later than budget_ns
+  long long budget_ns;
+  long long max_ns;
+};
+
+void initJitter(JitterHistogram &h, long long budget_ns);
+void recordJitter(JitterHistogram &h, long long late_ns);
+// Lateness in us below which `fraction` of the samples fall
+long long jitterPercentile(const JitterHistogram &h, double fraction);
+void printJitter(const JitterHistogram &h, FILE *out);
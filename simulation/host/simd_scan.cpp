@@ -0,0 +1,57 @@
+#include "simd_scan.h"
+
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+const char *findNewline(const char *p, const char *end) {
+#if defined(__AVX2__)
+  const __m256i nl = _mm256_set1_epi8('\n');
+  for (; p + 32 <= end; p += 32) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#elif defined(__SSE2__)
+  const __m128i nl = _mm_set1_epi8('\n');
+  for (; p + 16 <= end; p += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#endif
+  const char *hit = (const char *)memchr(p, '\n', end - p);
+  return hit ? hit : end;
+}
+
+uint64_t matchMask64(const char *p, char a, char b) {
+#if defined(__AVX2__)
+  const __m256i va = _mm256_set1_epi8(a);
+  const __m256i vb = _mm256_set1_epi8(b);
+  uint64_t mask = 0;
+  for (int half = 0; half < 2; half++) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)(p + half * 32));
+    __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb));
+    mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(hit) << (half * 32);
+  }
+  return mask;
+#elif defined(__SSE2__)
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  uint64_t mask = 0;
+  for (int quarter = 0; quarter < 4; quarter++) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(p + quarter * 16));
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb));
+    mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(hit) << (quarter * 16);
+  }
+  return mask;
+#else
+  uint64_t mask = 0;
+  for (int i = 0; i < 64; i++) {
+    if (p[i] == a || p[i] == b) mask |= 1ULL << i;
+  }
+  return mask;
+#endif
+}
@@ -0,0 +1,13 @@
+// SIMD byte scanning shared by the text importers.
+//
+// AVX2 is used when the build enables it (-march=native or -mavx2), SSE2
+// otherwise on x86-64, and plain loops elsewhere.
+#pragma once
+
+#include <stdint.h>
+
+// Returns the first '\n' in [p, end), or end
+const char *findNewline(const char *p, const char *end);
+
+// Bit i is set where p[i] is `a` or `b`, for the 64 bytes at p
+uint64_t matchMask64(const char *p, char a, char b);
@@ -0,0 +1,48 @@
+#include "spillback.h"
+
+void initSpillbackDetector(SpillbackDetector &d) {
+  d.occupied = false;
+  d.edge_ms = 0;
+  d.clear_ms = 0;
+  d.episodes = 0;
+}
+
+void spillbackEdge(SpillbackDetector &d, bool occupied, uint32_t now_ms) {
+  if (occupied == d.occupied) return;
+  // Episodes are counted as the loop frees; one that re-occupies the loop
+  // while still clearing continues the same episode
+  if (!occupied && now_ms - d.edge_ms >= SPILLBACK_ON_MS) {
+    if ((int32_t)(d.clear_ms - now_ms) <= 0) d.episodes++;
+    d.clear_ms = now_ms + SPILLBACK_OFF_MS;
+  }
+  d.occupied = occupied;
+  d.edge_ms = now_ms;
+}
+
+bool spillbackBlocked(const SpillbackDetector &d, uint32_t now_ms) {
+  if (d.occupied) return now_ms - d.edge_ms >= SPILLBACK_ON_MS || (int32_t)(d.clear_ms - now_ms) > 0;
+  return (int32_t)(d.clear_ms - now_ms) > 0;
+}
+
+uint8_t spillbackInputs(const ControllerState &c, uint8_t inputs, uint8_t raw, uint8_t blocked,
+                        TimingPlan &plan, SpillbackAction &action) {
+  action = SPILLBACK_NONE;
+  if ((raw & (IN_EMERGENCY | IN_RESET)) || blocked == 0) return inputs;
+
+  bool ns = c.current_state == NS_GREEN;
+  bool ew = c.current_state == EW_GREEN;
+  uint8_t own = ns ? IN_NS_ANY : ew ? IN_EW_ANY : 0;
+  uint8_t conflicting = ns ? IN_EW_ANY : ew ? IN_NS_ANY : 0;
+
+  // Shorten: nothing waiting on this green can leave, and someone else can
+  if (own && (raw & own) && !(raw & own & ~blocked) && (raw & conflicting & ~blocked)) {
+    if (ns && plan.ns_green_ms > SPILLBACK_GATED_GREEN_MS) plan.ns_green_ms = SPILLBACK_GATED_GREEN_MS;
+    if (ew && plan.ew_green_ms > SPILLBACK_GATED_GREEN_MS) plan.ew_green_ms = SPILLBACK_GATED_GREEN_MS;
+    action = SPILLBACK_SHORTEN;
+    return (inputs | (raw & conflicting)) & ~blocked;
+  }
+
+  // Skip: calls from lanes that only feed blocked links are withheld
+  if (inputs & blocked & ~own) action = SPILLBACK_SKIP;
+  return inputs & ~(blocked & ~own);
+}
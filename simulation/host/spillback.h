@@ -0,0 +1,45 @@
+// Spillback detection on downstream links and green gating against it.
+//
+// Each link carries an exit-side loop just past the upstream intersection.
+// A loop held occupied for SPILLBACK_ON_MS means the link's queue has reached
+// back to the intersection; it counts as clear again once the loop has been
+// free for SPILLBACK_OFF_MS. The detector is driven by loop edges and
+// answers "blocked now?" from its last edge, so both cost O(1).
+//
+// spillbackInputs() gates the FSM with the blocked mask of an intersection
+// (the IN_* bits of approach lanes whose downstream link is blocked): a red
+// approach that only feeds blocked links does not call its green (skip),
+// and a running green whose every waiting lane feeds a blocked link is cut
+// to SPILLBACK_GATED_GREEN_MS when another approach is waiting (shorten).
+#pragma once
+
+#include <stdint.h>
+
+#include "controller.h"
+
+const uint32_t SPILLBACK_ON_MS = 3000;
+const uint32_t SPILLBACK_OFF_MS = 2000;
+const uint32_t SPILLBACK_GATED_GREEN_MS = 3000;
+
+struct SpillbackDetector {
+  bool occupied;
+  uint32_t edge_ms;          // Last change of the loop
+  uint32_t clear_ms;         // Blocked until this time after the loop freed
+  uint32_t episodes;         // Times the link was found blocked
+};
+
+enum SpillbackAction : uint8_t {
+  SPILLBACK_NONE,
+  SPILLBACK_SKIP,            // A blocked approach's call was withheld
+  SPILLBACK_SHORTEN          // The running green was cut short
+};
+
+void initSpillbackDetector(SpillbackDetector &d);
+
+void spillbackEdge(SpillbackDetector &d, bool occupied, uint32_t now_ms);
+bool spillbackBlocked(const SpillbackDetector &d, uint32_t now_ms);
+
+// Gates `inputs` with `blocked` and may shorten the running green in `plan`.
+// `raw` is the detector mask before any other input shaping.
+uint8_t spillbackInputs(const ControllerState &c, uint8_t inputs, uint8_t raw, uint8_t blocked,
+                        TimingPlan &plan, SpillbackAction &action);
@@ -0,0 +1,270 @@
+// stim_fuzz: coverage-guided stimulus generator for the controller FSM.
+//
+// Keeps a corpus of short stimulus sequences and mutates them (flip an input,
+// retime an event to a timer boundary, insert, delete, splice) in the style
+// of libFuzzer. Each mutant is run through the in-process controller with
+// coverage on and kept only if it reaches a cell or edge nothing else has.
+// Delays are whole clock cycles of Traffic_Controller.v (100 ms of the
+// default plan), so retiming to "dwell - 1", "dwell" and "dwell + 1" lands
+// exactly on the RTL timer boundaries.
+//
+// At the end the corpus is reduced to a small set of sequences covering the
+// same bits, each shrunk event by event, and exported as a $readmemh file
+// that tb_traffic_controller.v replays when built with
+// +define+STIMULUS_FILE=\"fuzz.hex\". Word 0 is the record count; each record
+// is delay_cycles << 8 | inputs, with inputs laid out as the IN_* mask.
+//
+// Coverage is that of the C++ FSM, whose timing differs from the RTL in a
+// few places: with emergency active, Traffic_Controller.v leaves EW_YELLOW
+// and EMERGENCY_TRANS on the next cycle, where the C++ model waits out
+// yellow_ms and emergency_wait_ms, and the RTL leaves INIT after one cycle
+// instead of init_ms. Sequences that aim at those timer boundaries can
+// reach different cells on the testbench, so check its coverage log.
+//
+// Usage: stim_fuzz [-n executions] [-r seed] [-o fuzz.hex]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "coverage.h"
+
+const unsigned long MS_PER_CYCLE = 100;   // DEFAULT_TIMING / Traffic_Controller.v parameters
+const size_t MAX_EVENTS = 48;
+const uint32_t MAX_DELAY_CYCLES = 300;
+const unsigned long TAIL_MS = 30000;      // Run on after the last event so timers expire
+const uint32_t RESET_HOLD_CYCLES = 3;     // Same as the testbench's reset
+
+struct Event {
+  uint32_t delay_cycles; // Since the previous event (or reset release)
+  uint8_t inputs;        // IN_* mask
+};
+
+struct CorpusEntry {
+  std::vector<Event> events;
+  CoverageMap coverage;
+};
+
+static uint32_t xorshift(uint32_t &s) {
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return s;
+}
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Delays that put an input change on or next to a timer expiry
+static std::vector<uint32_t> boundaryDelays(const TimingPlan &plan) {
+  std::vector<uint32_t> delays;
+  delays.push_back(0);
+  delays.push_back(1);
+  for (int s = 0; s < NUM_STATES; s++) {
+    uint32_t dwell = stateDwell((StateType)s, plan) / MS_PER_CYCLE;
+    if (dwell > 0) delays.push_back(dwell - 1);
+    delays.push_back(dwell);
+    delays.push_back(dwell + 1);
+  }
+  return delays;
+}
+
+// Runs one sequence from reset release with coverage on
+static void execute(const std::vector<Event> &events, std::vector<StimulusRecord> &scratch,
+                    CoverageMap &map) {
+  scratch.clear();
+  unsigned long t = 0;
+  for (size_t i = 0; i < events.size(); i++) {
+    t += events[i].delay_cycles * MS_PER_CYCLE;
+    StimulusRecord r = { (uint32_t)t, events[i].inputs, { 0, 0, 0 } };
+    scratch.push_back(r);
+  }
+  initCoverage(map);
+  coverStimulus(scratch.data(), scratch.size(), 0, t + TAIL_MS, DEFAULT_TIMING, map);
+}
+
+static Event randomEvent(uint32_t &rng, const std::vector<uint32_t> &delays) {
+  Event e;
+  e.delay_cycles = (xorshift(rng) & 1) ? delays[xorshift(rng) % delays.size()]
+                                       : xorshift(rng) % MAX_DELAY_CYCLES;
+  e.inputs = xorshift(rng) & (IN_NS_ANY | IN_EW_ANY | IN_EMERGENCY);
+  // Reset occasionally, so edges into INIT are reachable but not dominant
+  if ((xorshift(rng) & 15) == 0) e.inputs |= IN_RESET;
+  return e;
+}
+
+static void mutate(std::vector<Event> &events, const std::vector<CorpusEntry> &corpus,
+                   uint32_t &rng, const std::vector<uint32_t> &delays) {
+  size_t n = events.size();
+  switch (xorshift(rng) % 7) {
+    case 0: // Flip one input bit
+      if (n > 0) events[xorshift(rng) % n].inputs ^= 1 << (xorshift(rng) % 6);
+      break;
+    case 1: // Retime to a timer boundary
+      if (n > 0) events[xorshift(rng) % n].delay_cycles = delays[xorshift(rng) % delays.size()];
+      break;
+    case 2: // Retime by a small step
+      if (n > 0) {
+        Event &e = events[xorshift(rng) % n];
+        e.delay_cycles = (e.delay_cycles + xorshift(rng) % 5 + MAX_DELAY_CYCLES - 2) % MAX_DELAY_CYCLES;
+      }
+      break;
+    case 3: // Insert
+      if (n < MAX_EVENTS) events.insert(events.begin() + (n ? xorshift(rng) % (n + 1) : 0),
+                                        randomEvent(rng, delays));
+      break;
+    case 4: // Delete
+      if (n > 0) events.erase(events.begin() + xorshift(rng) % n);
+      break;
+    case 5: // Duplicate, so a pulse can be repeated
+      if (n > 0 && n < MAX_EVENTS) {
+        size_t i = xorshift(rng) % n;
+        events.insert(events.begin() + i, events[i]);
+      }
+      break;
+    default: { // Splice the tail of another entry
+      const std::vector<Event> &other = corpus[xorshift(rng) % corpus.size()].events;
+      if (other.empty()) break;
+      size_t cut = n ? xorshift(rng) % n : 0;
+      size_t from = xorshift(rng) % other.size();
+      events.resize(cut);
+      for (size_t i = from; i < other.size() && events.size() < MAX_EVENTS; i++) {
+        events.push_back(other[i]);
+      }
+      break;
+    }
+  }
+}
+
+// Greedy set cover over the corpus, then drops every event whose removal
+// keeps the bits the entry was chosen for
+static std::vector<std::vector<Event> > minimize(const std::vector<CorpusEntry> &corpus,
+                                                 const CoverageMap &total) {
+  std::vector<std::vector<Event> > chosen;
+  std::vector<StimulusRecord> scratch;
+  CoverageMap covered;
+  initCoverage(covered);
+
+  while (hasNewCoverage(covered, total)) {
+    size_t best = 0;
+    int best_gain = -1;
+    for (size_t i = 0; i < corpus.size(); i++) {
+      int gain = __builtin_popcountll(corpus[i].coverage.edges & ~covered.edges);
+      for (int w = 0; w < COVERAGE_CELL_WORDS; w++) {
+        gain += __builtin_popcountll(corpus[i].coverage.cells[w] & ~covered.cells[w]);
+      }
+      if (gain > best_gain) {
+        best = i;
+        best_gain = gain;
+      }
+    }
+    if (best_gain <= 0) break;
+
+    // Bits this entry must keep providing
+    CoverageMap needed = corpus[best].coverage;
+    needed.edges &= ~covered.edges;
+    for (int w = 0; w < COVERAGE_CELL_WORDS; w++) needed.cells[w] &= ~covered.cells[w];
+
+    std::vector<Event> events = corpus[best].events;
+    for (size_t i = events.size(); i-- > 0;) {
+      std::vector<Event> trial = events;
+      if (i + 1 < trial.size()) trial[i + 1].delay_cycles += trial[i].delay_cycles;
+      trial.erase(trial.begin() + i);
+      CoverageMap run;
+      execute(trial, scratch, run);
+      if (!hasNewCoverage(run, needed)) events = trial;
+    }
+    mergeCoverage(covered, corpus[best].coverage);
+    chosen.push_back(events);
+  }
+  return chosen;
+}
+
+// One sequence per reset pulse, in the testbench replay format
+static bool exportHex(const char *path, const std::vector<std::vector<Event> > &sequences) {
+  std::vector<uint32_t> words;
+  for (size_t s = 0; s < sequences.size(); s++) {
+    words.push_back(IN_RESET);
+    words.push_back(RESET_HOLD_CYCLES << 8);
+    for (size_t i = 0; i < sequences[s].size(); i++) {
+      const Event &e = sequences[s][i];
+      words.push_back(e.delay_cycles << 8 | e.inputs);
+    }
+    words.push_back((TAIL_MS / MS_PER_CYCLE) << 8 | (sequences[s].empty() ? 0 : sequences[s].back().inputs));
+  }
+
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  fprintf(f, "%08x\n", (unsigned)words.size());
+  for (size_t i = 0; i < words.size(); i++) fprintf(f, "%08x\n", words[i]);
+  if (fclose(f) != 0) {
+    perror(path);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  unsigned long long executions = 2000000;
+  uint32_t rng = 0x2545F491;
+  const char *out_path = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:r:o:")) != -1) {
+    switch (opt) {
+      case 'n': executions = strtoull(optarg, NULL, 10); break;
+      case 'r': rng = (uint32_t)strtoul(optarg, NULL, 0) | 1; break;
+      case 'o': out_path = optarg; break;
+      default:
+        fprintf(stderr, "Usage: %s [-n executions] [-r seed] [-o fuzz.hex]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  std::vector<uint32_t> delays = boundaryDelays(DEFAULT_TIMING);
+  std::vector<StimulusRecord> scratch;
+  scratch.reserve(MAX_EVENTS);
+  std::vector<Event> candidate;
+  candidate.reserve(MAX_EVENTS);
+
+  // Seed: the empty sequence (power-on, no traffic)
+  std::vector<CorpusEntry> corpus(1);
+  execute(corpus[0].events, scratch, corpus[0].coverage);
+  CoverageMap total = corpus[0].coverage;
+
+  double start = nowSeconds();
+  for (unsigned long long n = 0; n < executions; n++) {
+    candidate = corpus[xorshift(rng) % corpus.size()].events;
+    int rounds = 1 + xorshift(rng) % 4;
+    for (int r = 0; r < rounds; r++) mutate(candidate, corpus, rng, delays);
+
+    CoverageMap run;
+    execute(candidate, scratch, run);
+    if (!hasNewCoverage(total, run)) continue;
+    mergeCoverage(total, run);
+    CorpusEntry entry;
+    entry.events = candidate;
+    entry.coverage = run;
+    corpus.push_back(entry);
+  }
+  double elapsed = nowSeconds() - start;
+
+  std::vector<std::vector<Event> > minimized = minimize(corpus, total);
+  size_t events = 0;
+  for (size_t i = 0; i < minimized.size(); i++) events += minimized[i].size();
+  fprintf(stderr, "%llu executions in %.2f s (%.2f M/s), corpus %zu, minimized to %zu sequences "
+                  "with %zu events\n",
+          executions, elapsed, elapsed > 0 ? executions / elapsed / 1e6 : 0.0, corpus.size(),
+          minimized.size(), events);
+  printCoverageReport(total, DEFAULT_TIMING);
+
+  if (out_path && !exportHex(out_path, minimized)) return 1;
+  return 0;
+}
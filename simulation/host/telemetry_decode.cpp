@@ -0,0 +1,157 @@
+// telemetry_decode: decodes the RTL controller's UART transition telemetry.
+//
+// Traffic_Controller.v sends one 5-byte record per state change; only the
+// first byte of a record has bit 7 set, so decoding can start mid-stream.
+// Input is the raw byte stream (a file, a pipe or a serial device, which is
+// switched to raw mode at -b baud) or, with -x, one hex byte per line as
+// written by the testbench's TELEMETRY_LOG receiver. Records are printed,
+// and with -o written as a transition trace with -u milliseconds per tick.
+//
+// Timestamps count the controller's prescaled tick (DEBOUNCE_PRESCALE clk
+// cycles) in 24 bits. They are unwrapped on the assumption that consecutive
+// records are less than one wrap apart; a longer silence is undercounted by
+// whole wraps, but the trace stays monotonic.
+//
+// Usage: telemetry_decode [-x] [-b baud] [-u ms_per_tick] [-o transitions.tlct] input
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+#include "trace.h"
+
+const int RECORD_BYTES = 5;
+const int RTL_FLASH_STATE = 7; // Fail-safe state, not in the C++ FSM
+const uint64_t TIMESTAMP_WRAP = 1ULL << 24;
+
+struct TelemetryRecord {
+  uint32_t ticks;    // Timestamp, prescaled ticks since reset (24 bits, wrapping)
+  uint8_t from;
+  uint8_t to;
+  uint8_t sensors;   // traffic_sensors[3:0]
+  bool emergency;
+};
+
+static const char *rtlStateName(int state) {
+  return state == RTL_FLASH_STATE ? "FLASH" : stateName((StateType)state);
+}
+
+// Unpacks {timestamp[23:0], emergency, sensors[3:0], to[2:0], from[2:0]}
+static TelemetryRecord unpack(const uint8_t bytes[RECORD_BYTES]) {
+  uint64_t w = 0;
+  for (int i = 0; i < RECORD_BYTES; i++) w = (w << 7) | (bytes[i] & 0x7F);
+  TelemetryRecord r;
+  r.from = w & 7;
+  r.to = (w >> 3) & 7;
+  r.sensors = (w >> 6) & 0xF;
+  r.emergency = (w >> 10) & 1;
+  r.ticks = (uint32_t)(w >> 11) & 0xFFFFFF;
+  return r;
+}
+
+static void configureSerial(int fd, unsigned long baud) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0) return; // Not a terminal
+  cfmakeraw(&tio);
+  speed_t speed = B115200;
+  switch (baud) {
+    case 9600: speed = B9600; break;
+    case 19200: speed = B19200; break;
+    case 38400: speed = B38400; break;
+    case 57600: speed = B57600; break;
+    case 230400: speed = B230400; break;
+    case 460800: speed = B460800; break;
+    case 921600: speed = B921600; break;
+    default: break;
+  }
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  tcsetattr(fd, TCSANOW, &tio);
+}
+
+int main(int argc, char **argv) {
+  bool hex = false;
+  unsigned long baud = 115200;
+  unsigned long ms_per_tick = 200; // DEBOUNCE_PRESCALE 2 at 100 ms per cycle
+  const char *out_path = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "xb:u:o:")) != -1) {
+    switch (opt) {
+      case 'x': hex = true; break;
+      case 'b': baud = strtoul(optarg, NULL, 10); break;
+      case 'u': ms_per_tick = strtoul(optarg, NULL, 10); break;
+      case 'o': out_path = optarg; break;
+      default:
+        optind = argc + 1;
+        break;
+    }
+  }
+  if (optind + 1 != argc) {
+    fprintf(stderr, "Usage: %s [-x] [-b baud] [-u ms_per_tick] [-o transitions.tlct] input\n",
+            argv[0]);
+    return 1;
+  }
+
+  FILE *in = fopen(argv[optind], "rb");
+  if (!in) {
+    perror(argv[optind]);
+    return 1;
+  }
+  if (!hex) configureSerial(fileno(in), baud);
+
+  std::vector<TransitionRecord> transitions;
+  uint8_t bytes[RECORD_BYTES];
+  int have = -1; // Bytes of the current record, -1 until a first byte is seen
+  unsigned long long records = 0, resyncs = 0, flash = 0;
+  uint64_t wraps = 0;      // Whole timestamp wraps so far, in ticks
+  uint32_t last_ticks = 0;
+  while (true) {
+    int c;
+    if (hex) {
+      unsigned value;
+      if (fscanf(in, "%x", &value) != 1) break;
+      c = value & 0xFF;
+    } else {
+      c = fgetc(in);
+      if (c == EOF) break;
+    }
+
+    if (c & 0x80) {
+      if (have > 0) resyncs++; // Previous record was cut short
+      have = 0;
+    } else if (have < 0) {
+      continue; // Waiting for a record boundary
+    }
+    bytes[have++] = (uint8_t)c;
+    if (have < RECORD_BYTES) continue;
+    have = -1;
+
+    TelemetryRecord r = unpack(bytes);
+    if (records > 0 && r.ticks < last_ticks) wraps += TIMESTAMP_WRAP;
+    last_ticks = r.ticks;
+    uint64_t ticks = wraps + r.ticks;
+    records++;
+    printf("%8llu %s -> %s sensors=%d%d%d%d emergency=%d\n", (unsigned long long)ticks,
+           rtlStateName(r.from), rtlStateName(r.to), (r.sensors >> 3) & 1, (r.sensors >> 2) & 1,
+           (r.sensors >> 1) & 1, r.sensors & 1, r.emergency ? 1 : 0);
+    fflush(stdout);
+
+    if (r.from == RTL_FLASH_STATE || r.to == RTL_FLASH_STATE) {
+      flash++;
+      continue;
+    }
+    TransitionRecord t = { (uint32_t)(ticks * ms_per_tick), r.from, r.to, 0, 0 };
+    transitions.push_back(t);
+  }
+  fclose(in);
+
+  fprintf(stderr, "%llu records, %llu cut short, %llu involving FLASH\n", records, resyncs, flash);
+  if (out_path && !writeTrace(out_path, TRACE_TRANSITIONS, transitions.data(),
+                              (uint32_t)transitions.size())) {
+    return 1;
+  }
+  return 0;
+}
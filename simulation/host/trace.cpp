@@ -0,0 +1,116 @@
+#include "trace.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool writeTrace(const char *path, TraceKind kind, const void *records, uint32_t count) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  TraceHeader header;
+  memcpy(header.magic, "TLCT", 4);
+  header.version = TRACE_VERSION;
+  header.kind = kind;
+  header.record_count = count;
+  header.reserved = 0;
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            (count == 0 || fwrite(records, 8, count, f) == count);
+  if (fclose(f) != 0) ok = false;
+  if (!ok) perror(path);
+  return ok;
+}
+
+bool mapTrace(const char *path, TraceKind kind, MappedTrace &trace) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    perror(path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+    fprintf(stderr, "%s: not a trace file\n", path);
+    close(fd);
+    return false;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror(path);
+    return false;
+  }
+
+  const TraceHeader *header = (const TraceHeader *)map;
+  const char *problem = NULL;
+  if (memcmp(header->magic, "TLCT", 4) != 0) {
+    problem = "not a trace file";
+  } else if (header->version != TRACE_VERSION) {
+    problem = "unsupported trace version";
+  } else if (header->kind != kind) {
+    problem = "wrong trace kind";
+  } else if (sizeof(TraceHeader) + (size_t)header->record_count * 8 > (size_t)st.st_size) {
+    problem = "truncated trace";
+  }
+  if (problem) {
+    fprintf(stderr, "%s: %s\n", path, problem);
+    munmap(map, st.st_size);
+    return false;
+  }
+
+  trace.header = header;
+  trace.records = header + 1;
+  trace.map_len = st.st_size;
+  return true;
+}
+
+void unmapTrace(MappedTrace &trace) {
+  if (trace.header) munmap((void *)trace.header, trace.map_len);
+  trace.header = NULL;
+  trace.records = NULL;
+}
+
+// Steps the controller at `now`, chaining transitions that are due at once.
+// Returns false if the state did not change.
+static bool stepAndRecord(ControllerState &c, uint8_t inputs, unsigned long now,
+                          const TimingPlan &plan, std::vector<TransitionRecord> &out) {
+  bool changed = false;
+  while (true) {
+    StateType from = c.current_state;
+    if (!stepController(c, inputs, now, plan)) return changed;
+    changed = true;
+    TransitionRecord r = { (uint32_t)now, from, c.current_state,
+                           (uint8_t)((inputs & IN_RESET) ? TRANSITION_RESET : 0), 0 };
+    out.push_back(r);
+    if (nextDeadline(c, inputs, plan) > now) return true;
+  }
+}
+
+void simulateStimulus(const StimulusRecord *stimulus, size_t count, unsigned long start_ms,
+                      unsigned long end_ms, const TimingPlan &plan,
+                      std::vector<TransitionRecord> &out) {
+  ControllerState c;
+  initController(c, start_ms);
+  uint8_t inputs = 0;
+
+  for (size_t i = 0; i <= count; i++) {
+    unsigned long until = i < count ? stimulus[i].t_ms : end_ms;
+
+    // Timed transitions up to the next input change; a timer due at the same
+    // millisecond fires first, as loop() would have seen it expire earlier
+    unsigned long deadline;
+    while ((deadline = nextDeadline(c, inputs, plan)) < until ||
+           (i < count && deadline == until)) {
+      if (!stepAndRecord(c, inputs, deadline, plan, out)) break;
+    }
+    if (i == count) break;
+
+    noteInputChange(c, inputs, stimulus[i].inputs, until);
+    inputs = stimulus[i].inputs;
+    stepAndRecord(c, inputs, until, plan, out);
+  }
+}
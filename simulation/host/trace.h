@@ -0,0 +1,70 @@
+// Replay trace files shared by the host tools.
+//
+// A trace is a 16-byte header followed by fixed 8-byte records, written in
+// host byte order so it can be mapped and used in place. Stimulus traces hold
+// input-mask changes; transition traces hold the state changes a controller
+// made, either logged by a board or produced by simulating a stimulus trace.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "controller.h"
+
+const uint16_t TRACE_VERSION = 1;
+
+enum TraceKind : uint16_t {
+  TRACE_STIMULUS = 1,
+  TRACE_TRANSITIONS = 2
+};
+
+struct TraceHeader {
+  char magic[4];          // "TLCT"
+  uint16_t version;
+  uint16_t kind;          // TraceKind
+  uint32_t record_count;
+  uint32_t reserved;
+};
+
+// Inputs take this value from t_ms until the next record
+struct StimulusRecord {
+  uint32_t t_ms;
+  uint8_t inputs;         // IN_* mask
+  uint8_t reserved[3];
+};
+
+// TransitionRecord.flags
+const uint8_t TRANSITION_TIME_INFERRED = 1 << 0; // No timestamp in the source log
+const uint8_t TRANSITION_RESET = 1 << 1;         // Caused by the reset input
+const uint8_t TRANSITION_AFTER_GAP = 1 << 2;     // Records were lost just before this one
+
+struct TransitionRecord {
+  uint32_t t_ms;
+  uint8_t from;           // StateType
+  uint8_t to;             // StateType
+  uint8_t flags;
+  uint8_t reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 16, "TraceHeader must stay 16 bytes");
+static_assert(sizeof(StimulusRecord) == 8, "StimulusRecord must stay 8 bytes");
+static_assert(sizeof(TransitionRecord) == 8, "TransitionRecord must stay 8 bytes");
+
+// Read-only view of a mapped trace file
+struct MappedTrace {
+  const TraceHeader *header;
+  const void *records;
+  size_t map_len;
+};
+
+bool writeTrace(const char *path, TraceKind kind, const void *records, uint32_t count);
+// Maps `path` and checks its header. Prints the reason and returns false on failure.
+bool mapTrace(const char *path, TraceKind kind, MappedTrace &trace);
+void unmapTrace(MappedTrace &trace);
+
+// Runs one controller over a stimulus trace, starting in INIT at `start_ms`
+// and stopping at `end_ms`, appending every transition it makes.
+void simulateStimulus(const StimulusRecord *stimulus, size_t count, unsigned long start_ms,
+                      unsigned long end_ms, const TimingPlan &plan,
+                      std::vector<TransitionRecord> &out);
@@ -0,0 +1,398 @@
+// trace_replay: paced replay of a stimulus trace for demos and training.
+//
+// The controller runs on the trace's own clock, exactly as simulateStimulus()
+// would run it; wall time only decides when each virtual instant is shown.
+// Pacing is anchored: virtual time is always anchor_virtual + (wall -
+// anchor_wall) * speed, and the thread sleeps until the absolute wall time of
+// the next transition or input change, so wake-up lateness never accumulates.
+// Pausing, seeking and changing speed just move the anchor.
+//
+// Light states stream as text lines "<t_ms> <state> <lights>" to every viewer
+// connected to the UNIX socket (-l), and to stdout. Commands are read from
+// stdin and from viewers, one per line:
+//   pause | play | step | seek <seconds> | speed <factor> | status | quit
+// `step` advances a paused replay to its next event. Seeks restore the
+// nearest keyframe (taken every KEYFRAME_RECORDS input changes at load) and
+// replay silently from there. Without a viewer socket, the replay exits once
+// stdin is closed and playback pauses or reaches the end.
+//
+// Usage: trace_replay [-x speed] [-l viewer_socket] [-p] stimulus.tlct
+//   -p starts paused.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "rt.h"
+#include "trace.h"
+
+const size_t KEYFRAME_RECORDS = 4096;
+const int MAX_VIEWERS = 32;
+const size_t COMMAND_MAX = 128;
+
+// Position of a replay: controller, inputs and the next record to apply
+struct ReplayCursor {
+  ControllerState c;
+  uint8_t inputs;
+  size_t next;
+  unsigned long now_ms;
+};
+
+struct Viewer {
+  int fd;
+  size_t len;                 // Bytes of a partial command line
+  char line[COMMAND_MAX];
+};
+
+// --- Replay State ---
+static const StimulusRecord *stimulus;
+static size_t stimulus_count;
+static unsigned long start_ms, end_ms;
+static std::vector<ReplayCursor> keyframes;   // Cursor before record i * KEYFRAME_RECORDS
+static ReplayCursor cursor;
+static bool paused = false;
+static double speed = 1.0;
+static long long anchor_wall_ns;
+static double anchor_virtual_ms;
+
+static Viewer viewers[MAX_VIEWERS];
+static int viewer_count = 0;
+static volatile sig_atomic_t stop_requested = 0;
+
+static void onSignal(int) { stop_requested = 1; }
+
+static long long monotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// --- Output ---
+static void dropViewer(int i) {
+  close(viewers[i].fd);
+  viewers[i] = viewers[--viewer_count];
+}
+
+// A viewer that cannot take a line right away is dropped, not buffered
+static void sendToViewers(const char *text, size_t len) {
+  for (int i = 0; i < viewer_count;) {
+    ssize_t n = send(viewers[i].fd, text, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n != (ssize_t)len) {
+      dropViewer(i);
+      continue;
+    }
+    i++;
+  }
+}
+
+static void broadcast(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static void broadcast(const char *fmt, ...) {
+  char text[256];
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(text, sizeof(text), fmt, args);
+  va_end(args);
+  if (len < 0) return;
+  if ((size_t)len >= sizeof(text)) len = sizeof(text) - 1;
+  fputs(text, stdout);
+  fflush(stdout);
+  sendToViewers(text, len);
+}
+
+static void announceState(unsigned long t_ms, StateType state) {
+  broadcast("%lu %s %u\n", t_ms, stateName(state), (unsigned)lightsForState(state));
+}
+
+// --- Replay Engine ---
+static unsigned long nextEventMs(const ReplayCursor &r) {
+  unsigned long deadline = nextDeadline(r.c, r.inputs, DEFAULT_TIMING);
+  if (r.next < stimulus_count && stimulus[r.next].t_ms < deadline) return stimulus[r.next].t_ms;
+  return deadline;
+}
+
+// Steps at `now`, chaining transitions due at once (as trace.cpp does)
+static void stepChained(ReplayCursor &r, unsigned long now, bool announce) {
+  while (stepController(r.c, r.inputs, now, DEFAULT_TIMING)) {
+    if (announce) announceState(now, r.c.current_state);
+    if (nextDeadline(r.c, r.inputs, DEFAULT_TIMING) > now) return;
+  }
+}
+
+// Applies every timer and input change up to and including `target`. A
+// timer due at the same millisecond as an input change fires first.
+static void advanceTo(ReplayCursor &r, unsigned long target, bool announce) {
+  while (true) {
+    unsigned long until = r.next < stimulus_count ? stimulus[r.next].t_ms : NO_DEADLINE;
+    unsigned long deadline = nextDeadline(r.c, r.inputs, DEFAULT_TIMING);
+    if (deadline <= until && deadline <= target) {
+      stepChained(r, deadline, announce);
+      continue;
+    }
+    if (until > target) break;
+    noteInputChange(r.c, r.inputs, stimulus[r.next].inputs, until);
+    r.inputs = stimulus[r.next].inputs;
+    r.next++;
+    stepChained(r, until, announce);
+  }
+  if (target > r.now_ms) r.now_ms = target;
+}
+
+static void initCursor(ReplayCursor &r) {
+  initController(r.c, start_ms);
+  r.inputs = 0;
+  r.next = 0;
+  r.now_ms = start_ms;
+}
+
+static void buildKeyframes() {
+  ReplayCursor r;
+  initCursor(r);
+  for (size_t i = 0; i < stimulus_count; i += KEYFRAME_RECORDS) {
+    // Everything before record i's millisecond
+    if (i > 0) advanceTo(r, stimulus[i].t_ms - 1, false);
+    keyframes.push_back(r);
+  }
+}
+
+// --- Pacing ---
+static void reanchor() {
+  anchor_wall_ns = monotonicNs();
+  anchor_virtual_ms = (double)cursor.now_ms;
+}
+
+static unsigned long virtualNow(long long wall_ns) {
+  double v = anchor_virtual_ms + (wall_ns - anchor_wall_ns) / 1e6 * speed;
+  return v >= end_ms ? end_ms : (unsigned long)v;
+}
+
+static long long wallForVirtual(unsigned long t_ms) {
+  return anchor_wall_ns + (long long)((t_ms - anchor_virtual_ms) / speed * 1e6);
+}
+
+// --- Commands ---
+static void seekTo(unsigned long target) {
+  if (target < start_ms) target = start_ms;
+  if (target > end_ms) target = end_ms;
+  size_t k = keyframes.size() - 1;
+  while (k > 0 && keyframes[k].now_ms > target) k--;
+  if (target < cursor.now_ms || keyframes[k].now_ms > cursor.now_ms) cursor = keyframes[k];
+  advanceTo(cursor, target, false);
+  reanchor();
+  broadcast("# at %.3f s\n", cursor.now_ms / 1000.0);
+  announceState(cursor.now_ms, cursor.c.current_state);
+}
+
+static void runCommand(char *line) {
+  char word[16];
+  double value = 0;
+  int fields = sscanf(line, "%15s %lf", word, &value);
+  if (fields < 1) return;
+  if (strcmp(word, "pause") == 0) {
+    if (!paused) advanceTo(cursor, virtualNow(monotonicNs()), true);
+    paused = true;
+    broadcast("# paused at %.3f s\n", cursor.now_ms / 1000.0);
+  } else if (strcmp(word, "play") == 0) {
+    paused = false;
+    reanchor();
+    broadcast("# playing at x%g\n", speed);
+  } else if (strcmp(word, "step") == 0) {
+    if (!paused) {
+      advanceTo(cursor, virtualNow(monotonicNs()), true);
+      paused = true;
+    }
+    unsigned long next = nextEventMs(cursor);
+    advanceTo(cursor, next < end_ms ? next : end_ms, true);
+    broadcast("# paused at %.3f s\n", cursor.now_ms / 1000.0);
+  } else if (strcmp(word, "seek") == 0 && fields == 2 && value >= 0) {
+    seekTo((unsigned long)(value * 1000));
+  } else if (strcmp(word, "speed") == 0 && fields == 2 && value > 0) {
+    if (!paused) advanceTo(cursor, virtualNow(monotonicNs()), true);
+    speed = value;
+    reanchor();
+    broadcast("# speed x%g\n", speed);
+  } else if (strcmp(word, "status") == 0) {
+    broadcast("# %s at %.3f s of %.3f s, x%g, %s\n", paused ? "paused" : "playing",
+              cursor.now_ms / 1000.0, end_ms / 1000.0, speed, stateName(cursor.c.current_state));
+  } else if (strcmp(word, "quit") == 0) {
+    stop_requested = 1;
+  } else {
+    broadcast("# unknown command: %s\n", word);
+  }
+}
+
+// Splits `data` into lines, carrying a partial line in `pending`
+static void feedCommands(char *pending, size_t &len, const char *data, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (data[i] == '\n') {
+      pending[len] = '\0';
+      runCommand(pending);
+      len = 0;
+    } else if (len + 1 < COMMAND_MAX) {
+      pending[len++] = data[i];
+    }
+  }
+}
+
+static int openViewerSocket(const char *path) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path);
+  if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int main(int argc, char **argv) {
+  const char *socket_path = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "x:l:p")) != -1) {
+    switch (opt) {
+      case 'x': speed = atof(optarg); break;
+      case 'l': socket_path = optarg; break;
+      case 'p': paused = true; break;
+      default:
+        optind = argc + 1;
+        break;
+    }
+  }
+  if (optind + 1 != argc || speed <= 0) {
+    fprintf(stderr, "Usage: %s [-x speed] [-l viewer_socket] [-p] stimulus.tlct\n", argv[0]);
+    return 1;
+  }
+
+  MappedTrace trace;
+  if (!mapTrace(argv[optind], TRACE_STIMULUS, trace)) return 1;
+  stimulus = (const StimulusRecord *)trace.records;
+  stimulus_count = trace.header->record_count;
+  if (stimulus_count == 0) {
+    fprintf(stderr, "%s: no records\n", argv[optind]);
+    return 1;
+  }
+  start_ms = stimulus[0].t_ms;
+  end_ms = stimulus[stimulus_count - 1].t_ms;
+  buildKeyframes();
+
+  int listen_fd = -1;
+  if (socket_path) {
+    listen_fd = openViewerSocket(socket_path);
+    if (listen_fd < 0) {
+      perror(socket_path);
+      return 1;
+    }
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  static JitterHistogram lateness;
+  initJitter(lateness, 1000000); // Budget: 1 ms late
+
+  fprintf(stderr, "trace_replay: %zu records, %.1f s, x%g%s\n", stimulus_count,
+          (end_ms - start_ms) / 1000.0, speed, paused ? ", paused" : "");
+  initCursor(cursor);
+  reanchor();
+  announceState(cursor.now_ms, cursor.c.current_state);
+
+  char console[COMMAND_MAX];
+  size_t console_len = 0;
+  bool console_open = true;
+  long long waiting_for = -1; // Wall deadline being slept toward, for lateness
+  while (!stop_requested) {
+    long long timeout_ns = -1;
+    if (!paused) {
+      long long now = monotonicNs();
+      if (waiting_for >= 0) recordJitter(lateness, now - waiting_for);
+      waiting_for = -1;
+      advanceTo(cursor, virtualNow(now), true);
+      if (cursor.now_ms >= end_ms) {
+        paused = true;
+        broadcast("# end of trace at %.3f s\n", cursor.now_ms / 1000.0);
+      } else {
+        unsigned long next = nextEventMs(cursor);
+        waiting_for = wallForVirtual(next < end_ms ? next : end_ms);
+        timeout_ns = waiting_for > now ? waiting_for - now : 0;
+      }
+    }
+
+    // Nothing left that could resume a paused replay
+    if (paused && !console_open && listen_fd < 0) break;
+
+    struct pollfd fds[MAX_VIEWERS + 2];
+    int n = 0;
+    fds[n].fd = console_open ? STDIN_FILENO : -1;
+    fds[n++].events = POLLIN;
+    fds[n].fd = listen_fd;
+    fds[n++].events = POLLIN;
+    for (int i = 0; i < viewer_count; i++) {
+      fds[n].fd = viewers[i].fd;
+      fds[n++].events = POLLIN;
+    }
+    struct timespec ts = { (time_t)(timeout_ns / 1000000000LL), (long)(timeout_ns % 1000000000LL) };
+    int ready = ppoll(fds, n, timeout_ns >= 0 ? &ts : NULL, NULL);
+    if (ready < 0 && errno != EINTR) {
+      perror("ppoll");
+      break;
+    }
+    if (ready <= 0) continue;
+    // A command arriving before the deadline is not a late wake
+    if (!paused) waiting_for = -1;
+
+    char data[512];
+    if (fds[0].revents & (POLLIN | POLLHUP)) {
+      ssize_t got = read(STDIN_FILENO, data, sizeof(data));
+      if (got <= 0) console_open = false;
+      else feedCommands(console, console_len, data, got);
+    }
+    if (fds[1].revents & POLLIN) {
+      int fd;
+      while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (viewer_count == MAX_VIEWERS) {
+          close(fd);
+          continue;
+        }
+        viewers[viewer_count].fd = fd;
+        viewers[viewer_count++].len = 0;
+        char line[64];
+        int len = snprintf(line, sizeof(line), "%lu %s %u\n", cursor.now_ms,
+                           stateName(cursor.c.current_state),
+                           (unsigned)lightsForState(cursor.c.current_state));
+        send(fd, line, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+      }
+    }
+    // Viewers from the poll set, matched by fd since commands may drop some
+    for (int p = 2; p < n; p++) {
+      if (!(fds[p].revents & (POLLIN | POLLHUP))) continue;
+      for (int i = 0; i < viewer_count; i++) {
+        if (viewers[i].fd != fds[p].fd) continue;
+        ssize_t got = recv(viewers[i].fd, data, sizeof(data), MSG_DONTWAIT);
+        if (got <= 0) dropViewer(i);
+        else feedCommands(viewers[i].line, viewers[i].len, data, got);
+        break;
+      }
+    }
+  }
+
+  printJitter(lateness, stderr);
+  for (int i = 0; i < viewer_count; i++) close(viewers[i].fd);
+  if (listen_fd >= 0) {
+    close(listen_fd);
+    unlink(socket_path);
+  }
+  unmapTrace(trace);
+  return 0;
+}
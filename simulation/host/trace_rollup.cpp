@@ -0,0 +1,113 @@
+// trace_rollup: builds rollup cubes from stimulus traces and prints one level.
+//
+// Every stimulus file is one intersection. Each is run through the controller,
+// its inputs and transitions feed that intersection's cube, and the cubes are
+// merged into a fleet cube whose cells are printed.
+//
+// Usage: trace_rollup [-l minute|hour|day] stimulus.tlct [stimulus.tlct ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "rollup.h"
+#include "trace.h"
+
+// Feeds one intersection's inputs and transitions to its cube in time order
+static void rollupTrace(const StimulusRecord *stimulus, size_t count, RollupCube &cube) {
+  if (count == 0) return;
+  unsigned long start = stimulus[0].t_ms;
+  unsigned long end = stimulus[count - 1].t_ms + 1;
+  std::vector<TransitionRecord> transitions;
+  simulateStimulus(stimulus, count, start, end, DEFAULT_TIMING, transitions);
+
+  RollupTracker tracker;
+  initRollupTracker(tracker, start);
+  size_t t = 0;
+  for (size_t i = 0; i < count; i++) {
+    while (t < transitions.size() && transitions[t].t_ms < stimulus[i].t_ms) {
+      rollupTransition(cube, tracker, (StateType)transitions[t].to, transitions[t].t_ms);
+      t++;
+    }
+    rollupInputs(cube, tracker, stimulus[i].inputs, stimulus[i].t_ms);
+  }
+  for (; t < transitions.size(); t++) {
+    rollupTransition(cube, tracker, (StateType)transitions[t].to, transitions[t].t_ms);
+  }
+  rollupFlush(cube, tracker, end);
+}
+
+static void printCell(const RollupCell &cell, RollupLevel level) {
+  uint32_t total = 0;
+  for (int s = 0; s < NUM_STATES; s++) total += cell.state_ms[s];
+  if (total == 0) total = 1;
+  double ns_green = 100.0 * (cell.state_ms[NS_GREEN] + cell.state_ms[EMERGENCY_GREEN]) / total;
+  double ew_green = 100.0 * cell.state_ms[EW_GREEN] / total;
+  double emergency = 100.0 * (cell.state_ms[EMERGENCY_GREEN] + cell.state_ms[EMERGENCY_TRANS]) / total;
+
+  printf("%10lu %6.1f %6.1f %6.1f %8u %7u %7u %7u/%-7u %7u/%-7u\n",
+         (unsigned long)cell.period * (ROLLUP_PERIOD_MS[level] / 1000), ns_green, ew_green,
+         emergency, cell.transitions, cell.demand_count[APPROACH_NS],
+         cell.demand_count[APPROACH_EW], rollupWaitPercentile(cell, APPROACH_NS, 0.5),
+         rollupWaitPercentile(cell, APPROACH_NS, 0.95), rollupWaitPercentile(cell, APPROACH_EW, 0.5),
+         rollupWaitPercentile(cell, APPROACH_EW, 0.95));
+}
+
+int main(int argc, char **argv) {
+  RollupLevel level = ROLLUP_HOUR;
+  int opt;
+  while ((opt = getopt(argc, argv, "l:")) != -1) {
+    if (opt == 'l' && strcmp(optarg, "minute") == 0) {
+      level = ROLLUP_MINUTE;
+    } else if (opt == 'l' && strcmp(optarg, "hour") == 0) {
+      level = ROLLUP_HOUR;
+    } else if (opt == 'l' && strcmp(optarg, "day") == 0) {
+      level = ROLLUP_DAY;
+    } else {
+      optind = argc + 1;
+      break;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "Usage: %s [-l minute|hour|day] stimulus.tlct [stimulus.tlct ...]\n", argv[0]);
+    return 1;
+  }
+
+  // Cubes are large; keep them off the stack
+  RollupCube *fleet = new RollupCube;
+  RollupCube *cube = new RollupCube;
+  initRollupCube(*fleet);
+  for (int i = optind; i < argc; i++) {
+    MappedTrace trace;
+    if (!mapTrace(argv[i], TRACE_STIMULUS, trace)) return 1;
+    initRollupCube(*cube);
+    rollupTrace((const StimulusRecord *)trace.records, trace.header->record_count, *cube);
+    mergeRollupCube(*fleet, *cube);
+    unmapTrace(trace);
+  }
+
+  // Oldest retained period first
+  const RollupCell *cells = level == ROLLUP_MINUTE ? fleet->minute
+                            : level == ROLLUP_HOUR ? fleet->hour : fleet->day;
+  std::vector<const RollupCell *> rows;
+  for (int i = 0; i < ROLLUP_CELLS[level]; i++) {
+    if (cells[i].period != ROLLUP_EMPTY_PERIOD) rows.push_back(&cells[i]);
+  }
+  for (size_t i = 1; i < rows.size(); i++) {
+    for (size_t j = i; j > 0 && rows[j - 1]->period > rows[j]->period; j--) {
+      const RollupCell *tmp = rows[j];
+      rows[j] = rows[j - 1];
+      rows[j - 1] = tmp;
+    }
+  }
+
+  printf("%10s %6s %6s %6s %8s %7s %7s %15s %15s\n", "start_s", "NS_G%", "EW_G%", "EMRG%",
+         "changes", "NS_dem", "EW_dem", "NS_wait p50/95", "EW_wait p50/95");
+  for (size_t i = 0; i < rows.size(); i++) printCell(*rows[i], level);
+
+  delete cube;
+  delete fleet;
+  return 0;
+}
@@ -0,0 +1,28 @@
+// Record layout spoken between traffic_daemon and its cabinet clients.
+//
+// Both directions use fixed 8-byte records on a SOCK_STREAM UNIX socket so
+// either side can read or write any number of them in one system call.
+#pragma once
+
+#include <stdint.h>
+
+const char *const DEFAULT_DAEMON_SOCKET = "/tmp/traffic_daemon.sock";
+
+// Cabinet -> daemon: current detector/emergency inputs of one intersection
+struct InputMsg {
+  uint16_t intersection;
+  uint8_t inputs;   // IN_* mask from controller.h
+  uint8_t reserved;
+  uint32_t seq;     // Echoed back in the StateMsg that answers this input
+};
+
+// Daemon -> cabinet: light state after an input or a timed transition
+struct StateMsg {
+  uint16_t intersection;
+  uint8_t state;    // StateType
+  uint8_t lights;   // LIGHT_* mask
+  uint32_t seq;     // 0 for transitions caused by a timer expiring
+};
+
+static_assert(sizeof(InputMsg) == 8, "InputMsg must stay 8 bytes");
+static_assert(sizeof(StateMsg) == 8, "StateMsg must stay 8 bytes");
@@ -19,6 +19,35 @@ const unsigned long YELLOW_MS = 2000;    // Yellow for all directions : 2 second
 const unsigned long EMERGENCY_WAIT_MS = 500; // Wait during Emergency Transition : 0.5 seconds
 const unsigned long INIT_MS = 100;       // Short duration during INIT state
 
+// Limits for retiming over the serial console
+const unsigned long MIN_GREEN_MS = 1000;
+const unsigned long MAX_GREEN_MS = 120000;
+const unsigned long MIN_YELLOW_MS = 1000;
+const unsigned long MAX_YELLOW_MS = 10000;
+
+// --- Serial Console ---
+// Commands arrive on Serial, one per line:
+//   status | counters | timing | set <ns|ew|yellow> <ms> | snapshot
+// Every reply line starts with "> " and a reply ends with "> ok" or
+// "> error <reason>". Each loop() reads at most CONSOLE_BYTES_PER_LOOP bytes
+// and writes at most one reply line, and only once the whole line fits in the
+// TX buffer, so the console never blocks the FSM. A new command is read only
+// after the previous reply has gone out.
+const int CONSOLE_BYTES_PER_LOOP = 4;
+const int CONSOLE_LINE_MAX = 32;        // Longest command, terminator included
+const int SERIAL_LINE_MAX = 64;         // Longest line written at once (the AVR TX buffer)
+
+// --- Telemetry ---
+// Log lines are queued as records and written only when a whole line fits in
+// the TX buffer, so a burst of transitions never stalls loop() on the
+// 9600-baud link. A full queue sheds by priority: periodic stats first, then
+// ordinary transitions, and emergency and reset records only when nothing
+// else is left. Stats and repeated resets coalesce into the record already
+// queued. A record written after shed ones is preceded by
+// "Telemetry dropped: N records".
+const int TELEMETRY_SLOTS = 16;
+const unsigned long STATS_PERIOD_MS = 60000;
+
 // --- State Definitions ---
 enum StateType {
   INIT,
@@ -35,15 +64,92 @@ StateType current_state = INIT;
 StateType next_state = INIT; // Stores the calculated next state
 unsigned long stateStartTime = 0; // Records when the current state started
 
+// Timing in use; starts from the constants above, retimable from the console
+unsigned long ns_green_ms = NS_GREEN_MS;
+unsigned long ew_green_ms = EW_GREEN_MS;
+unsigned long yellow_ms = YELLOW_MS;
+
 //Input Signal States
 bool reset_active = false;
 bool emergency_active = false;
 bool ns_sensor_active = false;
 bool ew_sensor_active = false;
 
+// Counters reported by the console
+unsigned long loop_count = 0;
+unsigned long state_changes = 0;
+unsigned long emergency_count = 0; // Entries into EMERGENCY_GREEN
+unsigned long reset_count = 0;     // Loop iterations spent in reset
+
+// Console state: the command being received and the reply being sent
+enum ReplyLine {
+  REPLY_SNAPSHOT = 1,
+  REPLY_STATUS = 2,
+  REPLY_INPUTS = 4,
+  REPLY_COUNTERS = 8,
+  REPLY_EVENTS = 16,
+  REPLY_SHED = 32,
+  REPLY_QUEUE = 64,
+  REPLY_TIMING = 128,
+  REPLY_ERROR = 256,
+  REPLY_OK = 512
+};
+
+// Everything a reply reports, captured when its command is parsed so that all
+// of its lines describe the same instant
+struct ConsoleSnapshot {
+  unsigned long time_ms;
+  StateType state;
+  unsigned long elapsed_ms;
+  bool reset, emergency, ns_sensor, ew_sensor;
+  unsigned long loops, changes, emergencies, resets;
+  unsigned long shed_emergency, shed_transition, shed_stats;
+  int queued;
+  unsigned long ns_green, ew_green, yellow;
+};
+
+char console_line[CONSOLE_LINE_MAX];
+int console_len = 0;
+bool console_overflow = false;    // Current line is too long; drop it at its end
+unsigned int reply_lines = 0;     // REPLY_* lines still to send, lowest first
+const char *reply_error = "";
+ConsoleSnapshot snapshot;
+
+// Telemetry queue, oldest record first
+enum TelemetryPriority {
+  PRIO_STATS,
+  PRIO_TRANSITION,
+  PRIO_EMERGENCY    // Emergency sequences and resets
+};
+
+enum TelemetryKind {
+  TELEMETRY_TRANSITION,
+  TELEMETRY_RESET,
+  TELEMETRY_STATS   // Values are read when the line is written
+};
+
+struct TelemetryRecord {
+  unsigned char kind;
+  unsigned char priority;
+  StateType from, to;
+  unsigned int skipped;  // Records shed just before this one
+  unsigned char line;    // Lines of this record already written
+};
+
+TelemetryRecord telemetry[TELEMETRY_SLOTS];
+int telemetry_count = 0;
+unsigned int telemetry_gap = 0;       // Records shed since the newest queued one
+unsigned long telemetry_shed[3] = { 0, 0, 0 }; // Per TelemetryPriority
+unsigned long stats_time = 0;         // When the last stats record was queued
+
 void readInputs();
 void updateLights();
-void printStateName(StateType state);
+const char *stateName(StateType state);
+void logTransition(StateType from, StateType to);
+void logReset();
+void logStats();
+void drainTelemetry();
+void serviceConsole();
 
 //Setup Function (runs once)
 void setup() {
@@ -74,15 +180,21 @@ void setup() {
 
 //Loop Function
 void loop() {
+  loop_count++;
+
   // 1. Read Inputs
   readInputs();
 
   // 2. Check for Reset which has highest priority
   if (reset_active) {
-    Serial.println("RESET Activated!");
+    logReset();
+    reset_count++;
     current_state = INIT;
     stateStartTime = millis(); // Reset timer
     updateLights();
+    // Telemetry and queries still go out while reset is held
+    drainTelemetry();
+    serviceConsole();
     delay(500); //Hold reset state briefly
     return; // Skip the rest of the loop iteration
   }
@@ -105,10 +217,10 @@ void loop() {
         break;
       case EW_GREEN:
         next_state = EW_YELLOW; //Change to Yellow first before switching
-        currentDuration = YELLOW_MS;
+        currentDuration = yellow_ms;
         break;
       case EW_YELLOW:
-        currentDuration = YELLOW_MS; // Check yellow duration
+        currentDuration = yellow_ms; // Check yellow duration
         if (elapsedTime >= currentDuration) {
              next_state = EMERGENCY_TRANS; // Go to transition state after yellow
              
@@ -144,7 +256,7 @@ void loop() {
         break;
 
       case NS_GREEN:
-        currentDuration = NS_GREEN_MS;
+        currentDuration = ns_green_ms;
         // Transition if timer expired AND there's demand from EW
         if (elapsedTime >= currentDuration && ew_sensor_active) {
           next_state = NS_YELLOW;
@@ -153,14 +265,14 @@ void loop() {
         break;
 
       case NS_YELLOW:
-        currentDuration = YELLOW_MS;
+        currentDuration = yellow_ms;
         if (elapsedTime >= currentDuration) {
           next_state = EW_GREEN;
         }
         break;
 
       case EW_GREEN:
-        currentDuration = EW_GREEN_MS;
+        currentDuration = ew_green_ms;
         // Transition if timer expired AND there's demand from NS
         if (elapsedTime >= currentDuration && ns_sensor_active) {
           next_state = EW_YELLOW;
@@ -168,7 +280,7 @@ void loop() {
         break;
 
       case EW_YELLOW:
-        currentDuration = YELLOW_MS;
+        currentDuration = yellow_ms;
         if (elapsedTime >= currentDuration) {
           next_state = NS_GREEN;
         }
@@ -177,14 +289,12 @@ void loop() {
       case EMERGENCY_TRANS:
          // Emergency ended during transition - revert to normal cycle safely
          // Go to NS_GREEN as a safe default after clearing
-         next_state = NS_GREEN;
-         Serial.println("Emergency ended during TRANS -> NS_GREEN");
+         next_state = NS_GREEN; // Logged with an "Emergency ended" notice
         break;
 
       case EMERGENCY_GREEN:
         // Emergency signal just went low, meaning transition is out of emergency state
-        next_state = NS_GREEN; // Return to normal NS Green
-        Serial.println("Emergency ended -> NS_GREEN");
+        next_state = NS_GREEN; // Return to normal NS Green, logged as above
         break;
 
        default:
@@ -196,18 +306,24 @@ void loop() {
 
   // 4. State Transition Logic
   if (next_state != current_state) {
-    Serial.print("State Change: ");
-    printStateName(current_state);
-    Serial.print(" -> ");
-    printStateName(next_state);
-    Serial.println();
+    logTransition(current_state, next_state);
 
     current_state = next_state;
     stateStartTime = currentTime; // Reset timer for the new state
+    state_changes++;
+    if (current_state == EMERGENCY_GREEN) emergency_count++;
 
     // Update lights immediately after state change
     updateLights();
   }  
+
+  // 5. Telemetry and operator console, after the FSM so neither holds up a transition
+  if (currentTime - stats_time >= STATS_PERIOD_MS) {
+    logStats();
+    stats_time = currentTime;
+  }
+  drainTelemetry();
+  serviceConsole();
 }
 
 //Helper Function: Read Inputs
@@ -254,16 +370,305 @@ void updateLights() {
   }
 }
 
-//Helper Function: Print State Name
-void printStateName(StateType state) {
+//Helper Function: State Name
+const char *stateName(StateType state) {
   switch (state) {
-    case INIT: Serial.print("INIT"); break;
-    case NS_GREEN: Serial.print("NS_GREEN"); break;
-    case NS_YELLOW: Serial.print("NS_YELLOW"); break;
-    case EW_GREEN: Serial.print("EW_GREEN"); break;
-    case EW_YELLOW: Serial.print("EW_YELLOW"); break;
-    case EMERGENCY_TRANS: Serial.print("EMERGENCY_TRANS"); break;
-    case EMERGENCY_GREEN: Serial.print("EMERGENCY_GREEN"); break;
-    default: Serial.print("UNKNOWN"); break;
+    case INIT: return "INIT";
+    case NS_GREEN: return "NS_GREEN";
+    case NS_YELLOW: return "NS_YELLOW";
+    case EW_GREEN: return "EW_GREEN";
+    case EW_YELLOW: return "EW_YELLOW";
+    case EMERGENCY_TRANS: return "EMERGENCY_TRANS";
+    case EMERGENCY_GREEN: return "EMERGENCY_GREEN";
+    default: return "UNKNOWN";
+  }
+}
+
+//Helper Function: Shed Queued Telemetry Record i
+void shedRecord(int i) {
+  TelemetryRecord &r = telemetry[i];
+  // Stats are not log events, so shedding one leaves no gap to report
+  unsigned int lost = r.skipped + (r.priority == PRIO_STATS ? 0 : 1);
+  telemetry_shed[r.priority]++;
+  for (int j = i; j < telemetry_count - 1; j++) telemetry[j] = telemetry[j + 1];
+  telemetry_count--;
+  if (i < telemetry_count) {
+    telemetry[i].skipped += lost;
+  } else {
+    telemetry_gap += lost;
+  }
+}
+
+//Helper Function: Queue a Telemetry Record, Shedding if Full
+void queueTelemetry(TelemetryKind kind, TelemetryPriority priority, StateType from, StateType to) {
+  if (telemetry_count == TELEMETRY_SLOTS) {
+    // Make room by shedding the newest record of the lowest priority below
+    // this one's; a record partly written is never cut short
+    int victim = -1;
+    for (int p = PRIO_STATS; p < priority && victim < 0; p++) {
+      for (int i = telemetry_count - 1; i >= 0; i--) {
+        if (telemetry[i].priority == p && (i > 0 || telemetry[0].line == 0)) {
+          victim = i;
+          break;
+        }
+      }
+    }
+    if (victim < 0) {
+      telemetry_shed[priority]++;
+      if (priority != PRIO_STATS) telemetry_gap++;
+      return;
+    }
+    shedRecord(victim);
+  }
+
+  TelemetryRecord &r = telemetry[telemetry_count++];
+  r.kind = kind;
+  r.priority = priority;
+  r.from = from;
+  r.to = to;
+  r.skipped = telemetry_gap;
+  r.line = 0;
+  telemetry_gap = 0;
+}
+
+//Helper Function: Log a State Change
+void logTransition(StateType from, StateType to) {
+  bool emergency = emergency_active || from == EMERGENCY_TRANS || from == EMERGENCY_GREEN ||
+                   to == EMERGENCY_TRANS || to == EMERGENCY_GREEN;
+  queueTelemetry(TELEMETRY_TRANSITION, emergency ? PRIO_EMERGENCY : PRIO_TRANSITION, from, to);
+}
+
+//Helper Function: Log a Reset (one record while a reset is held)
+void logReset() {
+  if (telemetry_count > 0 && telemetry[telemetry_count - 1].kind == TELEMETRY_RESET) return;
+  queueTelemetry(TELEMETRY_RESET, PRIO_EMERGENCY, INIT, INIT);
+}
+
+//Helper Function: Log Periodic Stats (coalesces with a stats record still queued)
+void logStats() {
+  for (int i = 0; i < telemetry_count; i++) {
+    if (telemetry[i].kind == TELEMETRY_STATS) return;
+  }
+  queueTelemetry(TELEMETRY_STATS, PRIO_STATS, INIT, INIT);
+}
+
+//Helper Function: Format Line r.line of a Record; True If It Is the Last
+bool telemetryLine(const TelemetryRecord &r, char *text, int size) {
+  int n = 0;
+  if (r.skipped > 0) {
+    if (r.line == n) {
+      snprintf(text, size, "Telemetry dropped: %u records", r.skipped);
+      return false;
+    }
+    n++;
+  }
+
+  switch (r.kind) {
+    case TELEMETRY_RESET:
+      snprintf(text, size, "RESET Activated!");
+      return true;
+    case TELEMETRY_STATS:
+      snprintf(text, size, "Stats: loops=%lu changes=%lu shed=%lu", loop_count, state_changes,
+               telemetry_shed[PRIO_STATS] + telemetry_shed[PRIO_TRANSITION] +
+                   telemetry_shed[PRIO_EMERGENCY]);
+      return true;
+    default:
+      break;
+  }
+
+  // Leaving an emergency state is announced ahead of its State Change
+  if ((r.from == EMERGENCY_TRANS || r.from == EMERGENCY_GREEN) && r.to == NS_GREEN) {
+    if (r.line == n) {
+      snprintf(text, size, r.from == EMERGENCY_TRANS ? "Emergency ended during TRANS -> NS_GREEN"
+                                                     : "Emergency ended -> NS_GREEN");
+      return false;
+    }
+  }
+  snprintf(text, size, "State Change: %s -> %s", stateName(r.from), stateName(r.to));
+  return true;
+}
+
+//Helper Function: Write Queued Telemetry While Whole Lines Fit in the TX Buffer
+void drainTelemetry() {
+  while (telemetry_count > 0) {
+    char text[SERIAL_LINE_MAX];
+    bool last = telemetryLine(telemetry[0], text, sizeof(text));
+    if ((int)strlen(text) + 2 > Serial.availableForWrite()) return;
+    Serial.println(text);
+    if (!last) {
+      telemetry[0].line++;
+      continue;
+    }
+    for (int j = 0; j < telemetry_count - 1; j++) telemetry[j] = telemetry[j + 1];
+    telemetry_count--;
+  }
+}
+
+//Helper Function: Capture Everything a Console Reply Reports
+void takeSnapshot() {
+  snapshot.time_ms = millis();
+  snapshot.state = current_state;
+  snapshot.elapsed_ms = snapshot.time_ms - stateStartTime;
+  snapshot.reset = reset_active;
+  snapshot.emergency = emergency_active;
+  snapshot.ns_sensor = ns_sensor_active;
+  snapshot.ew_sensor = ew_sensor_active;
+  snapshot.loops = loop_count;
+  snapshot.changes = state_changes;
+  snapshot.emergencies = emergency_count;
+  snapshot.resets = reset_count;
+  snapshot.shed_emergency = telemetry_shed[PRIO_EMERGENCY];
+  snapshot.shed_transition = telemetry_shed[PRIO_TRANSITION];
+  snapshot.shed_stats = telemetry_shed[PRIO_STATS];
+  snapshot.queued = telemetry_count;
+  snapshot.ns_green = ns_green_ms;
+  snapshot.ew_green = ew_green_ms;
+  snapshot.yellow = yellow_ms;
+}
+
+//Helper Function: Fail a Console Command
+void replyError(const char *reason) {
+  reply_error = reason;
+  reply_lines = REPLY_ERROR;
+}
+
+//Helper Function: Console "set <ns|ew|yellow> <ms>"
+void setTiming(char *args) {
+  char *value = args ? strchr(args, ' ') : NULL;
+  if (!value) {
+    replyError("usage: set ns|ew|yellow <ms>");
+    return;
+  }
+  *value++ = '\0';
+
+  char *end;
+  unsigned long ms = strtoul(value, &end, 10);
+  if (end == value || *end != '\0') {
+    replyError("bad value");
+    return;
+  }
+
+  unsigned long *target;
+  unsigned long lowest = MIN_GREEN_MS, highest = MAX_GREEN_MS;
+  if (strcmp(args, "ns") == 0) {
+    target = &ns_green_ms;
+  } else if (strcmp(args, "ew") == 0) {
+    target = &ew_green_ms;
+  } else if (strcmp(args, "yellow") == 0) {
+    target = &yellow_ms;
+    lowest = MIN_YELLOW_MS;
+    highest = MAX_YELLOW_MS;
+  } else {
+    replyError("unknown timing");
+    return;
+  }
+  if (ms < lowest || ms > highest) {
+    replyError("out of range");
+    return;
+  }
+  *target = ms; // Takes effect the next time that state's timer is checked
+  takeSnapshot();
+  reply_lines = REPLY_TIMING | REPLY_OK;
+}
+
+//Helper Function: Run One Console Command
+void runCommand(char *line) {
+  char *args = strchr(line, ' ');
+  if (args) *args++ = '\0';
+
+  takeSnapshot();
+  if (line[0] == '\0') {
+    return; // Blank line
+  } else if (strcmp(line, "status") == 0) {
+    reply_lines = REPLY_STATUS | REPLY_INPUTS | REPLY_OK;
+  } else if (strcmp(line, "counters") == 0) {
+    reply_lines = REPLY_COUNTERS | REPLY_EVENTS | REPLY_SHED | REPLY_QUEUE | REPLY_OK;
+  } else if (strcmp(line, "timing") == 0) {
+    reply_lines = REPLY_TIMING | REPLY_OK;
+  } else if (strcmp(line, "snapshot") == 0) {
+    reply_lines = REPLY_SNAPSHOT | REPLY_STATUS | REPLY_INPUTS | REPLY_COUNTERS |
+                  REPLY_EVENTS | REPLY_SHED | REPLY_QUEUE | REPLY_TIMING | REPLY_OK;
+  } else if (strcmp(line, "set") == 0) {
+    setTiming(args);
+  } else {
+    replyError("unknown command");
+  }
+}
+
+//Helper Function: Send the Next Reply Line if the TX Buffer Has Room
+void sendReplyLine() {
+  unsigned int line = reply_lines & -reply_lines; // Lowest pending line
+  char text[SERIAL_LINE_MAX];
+  switch (line) {
+    case REPLY_SNAPSHOT:
+      snprintf(text, sizeof(text), "> snapshot t_ms=%lu", snapshot.time_ms);
+      break;
+    case REPLY_STATUS:
+      snprintf(text, sizeof(text), "> state=%s elapsed_ms=%lu", stateName(snapshot.state),
+               snapshot.elapsed_ms);
+      break;
+    case REPLY_INPUTS:
+      snprintf(text, sizeof(text), "> ns=%d ew=%d emergency=%d reset=%d", snapshot.ns_sensor,
+               snapshot.ew_sensor, snapshot.emergency, snapshot.reset);
+      break;
+    case REPLY_COUNTERS:
+      snprintf(text, sizeof(text), "> loops=%lu changes=%lu", snapshot.loops, snapshot.changes);
+      break;
+    case REPLY_EVENTS:
+      snprintf(text, sizeof(text), "> emergencies=%lu resets=%lu", snapshot.emergencies,
+               snapshot.resets);
+      break;
+    case REPLY_SHED:
+      snprintf(text, sizeof(text), "> shed_emergency=%lu shed_transition=%lu",
+               snapshot.shed_emergency, snapshot.shed_transition);
+      break;
+    case REPLY_QUEUE:
+      snprintf(text, sizeof(text), "> shed_stats=%lu queued=%d", snapshot.shed_stats,
+               snapshot.queued);
+      break;
+    case REPLY_TIMING:
+      snprintf(text, sizeof(text), "> ns_green_ms=%lu ew_green_ms=%lu yellow_ms=%lu",
+               snapshot.ns_green, snapshot.ew_green, snapshot.yellow);
+      break;
+    case REPLY_ERROR:
+      snprintf(text, sizeof(text), "> error %s", reply_error);
+      break;
+    default:
+      snprintf(text, sizeof(text), "> ok");
+      break;
+  }
+
+  // The line and its CR LF go out whole or wait for the next loop()
+  if ((int)strlen(text) + 2 > Serial.availableForWrite()) return;
+  Serial.println(text);
+  reply_lines &= ~line;
+}
+
+//Helper Function: Serial Console (called once per loop)
+void serviceConsole() {
+  if (reply_lines != 0) {
+    sendReplyLine();
+    return;
+  }
+
+  for (int i = 0; i < CONSOLE_BYTES_PER_LOOP && Serial.available() > 0; i++) {
+    char c = (char)Serial.read();
+    if (c == '\r') continue;
+    if (c == '\n') {
+      console_line[console_len] = '\0';
+      if (console_overflow) {
+        replyError("line too long");
+      } else {
+        runCommand(console_line);
+      }
+      console_len = 0;
+      console_overflow = false;
+      return; // The reply starts on the next loop()
+    }
+    if (console_len < CONSOLE_LINE_MAX - 1) {
+      console_line[console_len++] = c;
+    } else {
+      console_overflow = true;
+    }
   }
 }
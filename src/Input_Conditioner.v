@@ -0,0 +1,74 @@
+//`default_nettype none
+
+// Input conditioning for asynchronous detector and emergency inputs.
+// Each input passes through a 2-flop synchronizer, then a debounce counter
+// that only accepts a new level once it has held for STABLE_TICKS ticks.
+// All inputs share one prescaler, so each input costs 2 sync flops, the
+// output flop and a COUNT_BITS counter.
+module Input_Conditioner #(
+    parameter WIDTH        = 5,   // Number of inputs
+    parameter PRESCALE     = 2,   // clk cycles per debounce tick
+    parameter STABLE_TICKS = 2    // Ticks a new level must hold to be accepted
+) (
+    input wire clk,
+    input wire reset,              // Asynchronous reset (active high)
+    input wire [WIDTH-1:0] raw,    // Unsynchronized inputs
+    output wire [WIDTH-1:0] clean, // Synchronized, debounced inputs
+    output wire tick               // Prescaled tick, shared with other slow logic
+);
+
+    // Counter widths: enough bits to hold PRESCALE - 1 and STABLE_TICKS - 1
+    localparam PRESCALE_BITS = PRESCALE > 1 ? $clog2(PRESCALE) : 1;
+    localparam COUNT_BITS = STABLE_TICKS > 1 ? $clog2(STABLE_TICKS) : 1;
+
+    // 2-flop synchronizers
+    reg [WIDTH-1:0] sync_meta, sync_out;
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            sync_meta <= 0;
+            sync_out  <= 0;
+        end else begin
+            sync_meta <= raw;
+            sync_out  <= sync_meta;
+        end
+    end
+
+    // Shared debounce tick: one clk pulse every PRESCALE cycles
+    reg [PRESCALE_BITS-1:0] prescale_count;
+    assign tick = (prescale_count == 0);
+    always @(posedge clk or posedge reset) begin
+        if (reset)
+            prescale_count <= 0;
+        else if (prescale_count == PRESCALE - 1)
+            prescale_count <= 0;
+        else
+            prescale_count <= prescale_count + 1'b1;
+    end
+
+    // Per-input debounce: count ticks while the synchronized level differs
+    // from the accepted one; any return to the accepted level restarts it
+    genvar i;
+    generate
+        for (i = 0; i < WIDTH; i = i + 1) begin : debounce
+            reg [COUNT_BITS-1:0] stable_count;
+            reg accepted;
+            always @(posedge clk or posedge reset) begin
+                if (reset) begin
+                    stable_count <= 0;
+                    accepted <= 1'b0;
+                end else if (sync_out[i] == accepted) begin
+                    stable_count <= 0;
+                end else if (tick) begin
+                    if (stable_count == STABLE_TICKS - 1) begin
+                        accepted <= sync_out[i];
+                        stable_count <= 0;
+                    end else begin
+                        stable_count <= stable_count + 1'b1;
+                    end
+                end
+            end
+            assign clean[i] = accepted;
+        end
+    endgenerate
+
+endmodule
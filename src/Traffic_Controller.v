@@ -6,7 +6,8 @@ module Traffic_Controller (
     input wire emergency,         // Emergency vehicle signal
     input wire [3:0] traffic_sensors, // [3]:EW2, [2]:EW1, [1]:NS2, [0]:NS1
     output reg [3:0] light,       // [3]:EW_Y, [2]:EW_G, [1]:NS_Y, [0]:NS_G
-    output wire [7:0] state_timer_out // Expose internal timer for simulation/debug
+    output wire [7:0] state_timer_out, // Expose internal timer for simulation/debug
+    output wire uart_tx           // Transition telemetry (see Uart_Telemetry.v)
 );
 
     // Parameters for state durations (in clock cycles)
@@ -15,6 +16,22 @@ module Traffic_Controller (
     parameter YELLOW_CYCLES   = 20;  // Duration for Yellow light (both directions)
     parameter EMERGENCY_WAIT  = 5;   // Short wait during emergency transition if needed
 
+    // Input conditioning (see Input_Conditioner.v); 0 feeds the raw inputs
+    // straight to the next-state logic
+    parameter CONDITION_INPUTS  = 1;
+    parameter DEBOUNCE_PRESCALE = 2; // Cycles per debounce tick
+    parameter DEBOUNCE_TICKS    = 2; // Ticks an input level must hold
+
+    // Fail-safe flash mode
+    parameter FLASH_TICKS       = 3;   // Debounce ticks per flash half-period (~50 flashes/min), max 16
+    parameter WATCHDOG_CYCLES   = 250; // Longest stay in a timed state before flashing, max 255
+
+    // Transition telemetry UART. A real baud rate needs a clock of at least
+    // that many Hz, while the state durations above are counted in clk cycles
+    // and assume 100 ms per cycle; the record timestamps count the prescaled
+    // tick instead, so set DEBOUNCE_PRESCALE to make the tick a useful unit.
+    parameter TELEMETRY_CLKS_PER_BIT = 1; // clk / baud, e.g. 434 for 115200 baud at 50 MHz
+
     // State definition using parameters
     parameter [2:0] INIT            = 3'b000;
     parameter [2:0] NS_GREEN        = 3'b001;
@@ -23,15 +40,41 @@ module Traffic_Controller (
     parameter [2:0] EW_YELLOW       = 3'b100;
     parameter [2:0] EMERGENCY_TRANS = 3'b101; // Intermediate state for emergency
     parameter [2:0] EMERGENCY_GREEN = 3'b110; // State when emergency vehicle has priority (NS Green)
+    parameter [2:0] FLASH           = 3'b111; // Fail-safe flashing, left only by reset
     
     reg [2:0] current_state, next_state; // State registers
 
     // Internal timer for state durations
     reg [7:0] state_timer; // Timer up to 256 cycles
 
+    // Synchronized and debounced inputs
+    wire [3:0] sensors_c;
+    wire emergency_c;
+    wire tick; // Prescaled tick from the conditioner (every cycle without it)
+
+    generate
+        if (CONDITION_INPUTS) begin : conditioning
+            Input_Conditioner #(
+                .WIDTH(5),
+                .PRESCALE(DEBOUNCE_PRESCALE),
+                .STABLE_TICKS(DEBOUNCE_TICKS)
+            ) inputs_c (
+                .clk(clk),
+                .reset(reset),
+                .raw({emergency, traffic_sensors}),
+                .clean({emergency_c, sensors_c}),
+                .tick(tick)
+            );
+        end else begin : no_conditioning
+            assign sensors_c = traffic_sensors;
+            assign emergency_c = emergency;
+            assign tick = 1'b1;
+        end
+    endgenerate
+
     // Sensor logic (combinational)
-    wire ns_sensor_active = traffic_sensors[1] | traffic_sensors[0];
-    wire ew_sensor_active = traffic_sensors[3] | traffic_sensors[2];
+    wire ns_sensor_active = sensors_c[1] | sensors_c[0];
+    wire ew_sensor_active = sensors_c[3] | sensors_c[2];
 
     // State Register Logic (Clocked)
     always @(posedge clk or posedge reset) begin
@@ -63,12 +106,50 @@ module Traffic_Controller (
         end
     end
 
+    // Fault detection: a timed state (INIT, yellows, EMERGENCY_TRANS) held
+    // past WATCHDOG_CYCLES. `light` is decoded from current_state and never
+    // drives both directions, so there is no separate conflict check.
+    reg [7:0] watchdog;
+    wire timed_state = (current_state == INIT) || (current_state == NS_YELLOW) ||
+                       (current_state == EW_YELLOW) || (current_state == EMERGENCY_TRANS);
+    wire watchdog_expired = (watchdog == WATCHDOG_CYCLES);
+    wire fault = watchdog_expired;
+
+    always @(posedge clk or posedge reset) begin
+        if (reset)
+            watchdog <= 0;
+        else if (!timed_state || next_state != current_state)
+            watchdog <= 0;
+        else if (!watchdog_expired)
+            watchdog <= watchdog + 1'b1;
+    end
+
+    // Flash phase, toggled every FLASH_TICKS prescaled ticks while flashing
+    reg [3:0] flash_count;
+    reg flash_phase;
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            flash_count <= 0;
+            flash_phase <= 1'b0;
+        end else if (current_state == FLASH && tick) begin
+            if (flash_count == FLASH_TICKS - 1) begin
+                flash_count <= 0;
+                flash_phase <= ~flash_phase;
+            end else begin
+                flash_count <= flash_count + 1'b1;
+            end
+        end
+    end
+
     // Next State Logic (Combinational) 
     always @(*) begin // Use @(*) for combinational logic sensitivity list
         next_state = current_state; // Default: stay in current state
 
+        // Faults latch flash mode until reset, above everything else
+        if (current_state == FLASH || fault) begin
+            next_state = FLASH;
         // Emergency has highest priority
-        if (emergency) begin
+        end else if (emergency_c) begin
             case (current_state)
                 NS_GREEN, EMERGENCY_GREEN: next_state = EMERGENCY_GREEN; // Already in or going to NS Green
                 EW_GREEN:                  next_state = EW_YELLOW;       // Go to EW Yellow first
@@ -126,7 +207,7 @@ module Traffic_Controller (
                      next_state = NS_GREEN;
                 end
                 default: begin
-                    next_state = INIT; // Should not happen in normal operation
+                    next_state = FLASH; // Should not happen in normal operation
                 end
             endcase
         end
@@ -143,6 +224,7 @@ module Traffic_Controller (
             EMERGENCY_TRANS: light = 4'b1000; // EW Yellow during transition to NS Green for emergency
             EMERGENCY_GREEN: light = 4'b0001; // NS Green during emergency
             INIT:            light = 4'b0000; // All Red initially
+            FLASH:           light = {flash_phase, 1'b0, flash_phase, 1'b0}; // Both yellows flashing
             default:         light = 4'b0000; // All Red if state is invalid (safety)
         endcase
     end
@@ -150,4 +232,24 @@ module Traffic_Controller (
     // Assign internal timer to output port
     assign state_timer_out = state_timer;
 
+    // Transition telemetry: one record per current_state change
+    // Record layout: {timestamp[23:0], emergency, sensors[3:0], to[2:0], from[2:0]}
+    reg [23:0] timestamp; // Prescaled ticks since reset, wrapping
+    always @(posedge clk or posedge reset) begin
+        if (reset)
+            timestamp <= 0;
+        else if (tick)
+            timestamp <= timestamp + 1'b1;
+    end
+
+    Uart_Telemetry #(
+        .CLKS_PER_BIT(TELEMETRY_CLKS_PER_BIT)
+    ) telemetry (
+        .clk(clk),
+        .reset(reset),
+        .event_valid(next_state != current_state),
+        .event_data({timestamp, emergency_c, sensors_c, next_state, current_state}),
+        .tx(uart_tx)
+    );
+
 endmodule
@@ -0,0 +1,33 @@
+//`default_nettype none
+
+// N independent Traffic_Controller instances on one clock, for simulating
+// a fleet of controllers in a single model (see testbench/fleet_harness.cpp).
+// Stimulus and observations are packed buses with a fixed stride per
+// instance, so a harness can drive and read every instance without
+// per-instance ports.
+module Traffic_Fleet #(
+    parameter N = 64,
+    parameter CONDITION_INPUTS = 1
+) (
+    input wire clk,
+    input wire [6*N-1:0] stimulus,   // Instance i: [6i+5]:reset, [6i+4]:emergency, [6i+3:6i]:sensors
+    output wire [4*N-1:0] lights,    // Instance i: [4i+3:4i] light, same layout as Traffic_Controller
+    output wire [N-1:0] uart_tx      // Instance i: telemetry line
+);
+
+    genvar i;
+    generate
+        for (i = 0; i < N; i = i + 1) begin : unit
+            Traffic_Controller #(.CONDITION_INPUTS(CONDITION_INPUTS)) controller (
+                .clk(clk),
+                .reset(stimulus[6*i+5]),
+                .emergency(stimulus[6*i+4]),
+                .traffic_sensors(stimulus[6*i+3 -: 4]),
+                .light(lights[4*i+3 -: 4]),
+                .state_timer_out(),
+                .uart_tx(uart_tx[i])
+            );
+        end
+    endgenerate
+
+endmodule
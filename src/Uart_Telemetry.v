@@ -0,0 +1,86 @@
+//`default_nettype none
+
+// Transition telemetry: queues packed 35-bit event records in a small FIFO
+// and sends each one over an 8N1 UART as five bytes of 7 payload bits,
+// most significant first. Only the first byte of a record has bit 7 set, so
+// a host decoder can find record boundaries from any starting point.
+// Events arriving while the FIFO is full are dropped.
+module Uart_Telemetry #(
+    parameter CLKS_PER_BIT = 1,    // clk frequency / baud rate
+    parameter FIFO_BITS    = 3     // FIFO holds 2**FIFO_BITS records
+) (
+    input wire clk,
+    input wire reset,              // Asynchronous reset (active high)
+    input wire event_valid,        // Push event_data this cycle
+    input wire [34:0] event_data,
+    output reg tx                  // UART line, idle high
+);
+
+    // Baud counter width, derived so any CLKS_PER_BIT fits
+    localparam BAUD_BITS = CLKS_PER_BIT > 1 ? $clog2(CLKS_PER_BIT) : 1;
+
+    // --- Record FIFO ---
+    reg [34:0] fifo [0:(1 << FIFO_BITS) - 1];
+    reg [FIFO_BITS:0] wr_ptr, rd_ptr; // Extra bit tells full from empty
+    wire fifo_empty = (wr_ptr == rd_ptr);
+    wire fifo_full  = (wr_ptr[FIFO_BITS] != rd_ptr[FIFO_BITS]) &&
+                      (wr_ptr[FIFO_BITS-1:0] == rd_ptr[FIFO_BITS-1:0]);
+
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            wr_ptr <= 0;
+        end else if (event_valid && !fifo_full) begin
+            fifo[wr_ptr[FIFO_BITS-1:0]] <= event_data;
+            wr_ptr <= wr_ptr + 1'b1;
+        end
+    end
+
+    // --- Serializer ---
+    // Shift register holds {stop, data[7:0], start}; one record is five bytes
+    reg [34:0] record;
+    reg [2:0] byte_index;      // Byte of `record` being sent, 0-4
+    reg [9:0] shift;
+    reg [3:0] bits_left;       // Bits of `shift` still to send, 0 when idle
+    reg [BAUD_BITS-1:0] baud_count;
+    reg busy;                  // A record is being sent
+
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            rd_ptr <= 0;
+            record <= 0;
+            byte_index <= 0;
+            shift <= 10'h3FF;
+            bits_left <= 0;
+            baud_count <= 0;
+            busy <= 1'b0;
+            tx <= 1'b1;
+        end else if (bits_left != 0) begin
+            // Mid-byte: hold each bit for CLKS_PER_BIT cycles
+            if (baud_count == CLKS_PER_BIT - 1) begin
+                baud_count <= 0;
+                tx <= shift[0];
+                shift <= {1'b1, shift[9:1]};
+                bits_left <= bits_left - 1'b1;
+            end else begin
+                baud_count <= baud_count + 1'b1;
+            end
+        end else if (busy) begin
+            // Byte done: start the next one or finish the record
+            if (byte_index == 4) begin
+                busy <= 1'b0;
+            end else begin
+                byte_index <= byte_index + 1'b1;
+                shift <= {1'b1, 1'b0, record[34 - 7 * (byte_index + 1) -: 7], 1'b0};
+                bits_left <= 10;
+            end
+        end else if (!fifo_empty) begin
+            record <= fifo[rd_ptr[FIFO_BITS-1:0]];
+            rd_ptr <= rd_ptr + 1'b1;
+            byte_index <= 0;
+            busy <= 1'b1;
+            shift <= {1'b1, 1'b1, fifo[rd_ptr[FIFO_BITS-1:0]][34:28], 1'b0}; // Marked first byte
+            bits_left <= 10;
+        end
+    end
+
+endmodule
@@ -0,0 +1,118 @@
+// fleet_harness: Verilator driver for src/Traffic_Fleet.v.
+//
+// Every instance gets its own stimulus stream: a per-instance generator
+// redraws its sensor mask every few hundred cycles, raises emergency now and
+// then and pulses reset rarely. The harness toggles the clock for the
+// requested number of cycles and reports instance-cycles per second, along
+// with how many light changes and FLASH-like outputs (both yellows lit)
+// were observed as a sanity check.
+//
+// The fleet size comes from the packed bus widths, so build with -GN set to
+// a multiple of 8 (whole 32-bit words of light bits). The verilator command
+// is in the README.
+//
+// Usage: obj_dir/fleet_sim [cycles]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include "VTraffic_Fleet.h"
+#include "verilated.h"
+
+const int STIMULUS_BITS = 6;
+const int LIGHT_BITS = 4;
+
+static uint32_t xorshift(uint32_t &s) {
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return s;
+}
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Bit-field access into Verilator's packed wide signals (arrays of 32-bit words)
+static void setField(uint32_t *words, int bit, int width, uint32_t value) {
+  for (int b = 0; b < width; b++, bit++) {
+    uint32_t mask = 1u << (bit & 31);
+    if ((value >> b) & 1) {
+      words[bit >> 5] |= mask;
+    } else {
+      words[bit >> 5] &= ~mask;
+    }
+  }
+}
+
+static uint32_t getField(const uint32_t *words, int bit, int width) {
+  uint32_t value = 0;
+  for (int b = 0; b < width; b++, bit++) value |= ((words[bit >> 5] >> (bit & 31)) & 1) << b;
+  return value;
+}
+
+int main(int argc, char **argv) {
+  Verilated::commandArgs(argc, argv);
+  unsigned long long cycles = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000;
+
+  VTraffic_Fleet *top = new VTraffic_Fleet;
+  // Wide ports are VlWide word arrays (narrow ones plain integers); either
+  // way the storage starts with the least significant 32-bit word
+  const int n = (int)(sizeof(top->lights) * 8 / LIGHT_BITS);
+  uint32_t *stimulus = (uint32_t *)&top->stimulus;
+  const uint32_t *lights = (const uint32_t *)&top->lights;
+
+  std::vector<uint32_t> rng(n);
+  std::vector<uint32_t> next_change(n, 0);
+  std::vector<uint8_t> last_light(n, 0);
+  for (int i = 0; i < n; i++) rng[i] = 0x9E3779B9u * (i + 1) | 1;
+
+  // Hold every instance in reset for a few cycles
+  for (int i = 0; i < n; i++) setField(stimulus, i * STIMULUS_BITS, STIMULUS_BITS, 0x20);
+  for (int c = 0; c < 3; c++) {
+    top->clk = 0;
+    top->eval();
+    top->clk = 1;
+    top->eval();
+  }
+
+  unsigned long long light_changes = 0, flashing = 0;
+  double start = nowSeconds();
+  for (unsigned long long cycle = 0; cycle < cycles; cycle++) {
+    for (int i = 0; i < n; i++) {
+      if (cycle < next_change[i]) continue;
+      uint32_t r = xorshift(rng[i]);
+      uint32_t inputs = r & 0xF;                     // Sensors
+      if ((r >> 8) % 50 == 0) inputs |= 0x10;        // Emergency
+      if ((r >> 16) % 2000 == 0) inputs |= 0x20;     // Reset pulse
+      setField(stimulus, i * STIMULUS_BITS, STIMULUS_BITS, inputs);
+      next_change[i] = cycle + 1 + (xorshift(rng[i]) % 400);
+    }
+
+    top->clk = 0;
+    top->eval();
+    top->clk = 1;
+    top->eval();
+
+    for (int i = 0; i < n; i++) {
+      uint8_t light = (uint8_t)getField(lights, i * LIGHT_BITS, LIGHT_BITS);
+      if (light != last_light[i]) light_changes++;
+      if ((light & 0xA) == 0xA) flashing++;
+      last_light[i] = light;
+    }
+  }
+  double elapsed = nowSeconds() - start;
+
+  printf("%d instances x %llu cycles in %.3f s: %.1f M instance-cycles/s\n", n, cycles, elapsed,
+         elapsed > 0 ? n * (double)cycles / elapsed / 1e6 : 0.0);
+  printf("%llu light changes, %llu instance-cycles showing flash\n", light_changes, flashing);
+
+  top->final();
+  delete top;
+  return 0;
+}
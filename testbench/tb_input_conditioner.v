@@ -0,0 +1,111 @@
+//`default_nettype none
+`timescale 1ns / 1ps // Define simulation time unit and precision
+
+module tb_input_conditioner();
+
+    // Small prescaler so the demo is short: a level must hold for 3 ticks of
+    // 4 cycles (9-12 cycles depending on tick phase) to be accepted
+    localparam PRESCALE     = 4;
+    localparam STABLE_TICKS = 3;
+    localparam CLK_PERIOD   = 10; // ns
+
+    reg clk;
+    reg reset;
+    reg [1:0] raw;   // [0]: sensor under test, [1]: held low throughout
+    wire [1:0] clean;
+
+    Input_Conditioner #(
+        .WIDTH(2),
+        .PRESCALE(PRESCALE),
+        .STABLE_TICKS(STABLE_TICKS)
+    ) uut (
+        .clk(clk),
+        .reset(reset),
+        .raw(raw),
+        .clean(clean)
+    );
+
+    always begin
+        clk = 1'b0;
+        #(CLK_PERIOD / 2);
+        clk = 1'b1;
+        #(CLK_PERIOD / 2);
+    end
+
+    // Count accepted edges on the sensor under test
+    integer rises, falls, errors;
+    reg last_clean;
+    always @(posedge clk) begin
+        if (clean[0] && !last_clean) rises = rises + 1;
+        if (!clean[0] && last_clean) falls = falls + 1;
+        last_clean <= clean[0];
+    end
+
+    task expect_counts(input integer exp_rises, input integer exp_falls, input [8*40-1:0] what);
+        begin
+            if (rises == exp_rises && falls == exp_falls && clean[1] == 1'b0)
+                $display("[%t ns] PASS: %0s", $time, what);
+            else begin
+                $display("[%t ns] FAIL: %0s (rises=%0d falls=%0d)", $time, what, rises, falls);
+                errors = errors + 1;
+            end
+        end
+    endtask
+
+    integer k;
+    initial begin
+        rises = 0;
+        falls = 0;
+        errors = 0;
+        last_clean = 1'b0;
+        reset = 1'b1;
+        raw = 2'b00;
+        repeat (3) @(posedge clk);
+        reset = 1'b0;
+        repeat (20) @(posedge clk);
+
+        // --- Scenario 1: single-cycle glitch, off the clock edge ---
+        #3 raw[0] = 1'b1;
+        #(CLK_PERIOD) raw[0] = 1'b0;
+        repeat (20) @(posedge clk);
+        expect_counts(0, 0, "1-cycle glitch rejected");
+
+        // --- Scenario 2: pulse shorter than the debounce window ---
+        #3 raw[0] = 1'b1;
+        #(6 * CLK_PERIOD) raw[0] = 1'b0;
+        repeat (20) @(posedge clk);
+        expect_counts(0, 0, "6-cycle pulse rejected");
+
+        // --- Scenario 3: contact bounce, then a steady press ---
+        for (k = 0; k < 5; k = k + 1) begin
+            #7 raw[0] = 1'b1;
+            #(2 * CLK_PERIOD) raw[0] = 1'b0;
+        end
+        raw[0] = 1'b1;
+        repeat (20) @(posedge clk);
+        expect_counts(1, 0, "bouncing press accepted once");
+
+        // --- Scenario 4: dropouts while held high ---
+        for (k = 0; k < 3; k = k + 1) begin
+            #(5 * CLK_PERIOD) raw[0] = 1'b0;
+            #(CLK_PERIOD) raw[0] = 1'b1;
+        end
+        repeat (20) @(posedge clk);
+        expect_counts(1, 0, "dropouts while held rejected");
+
+        // --- Scenario 5: clean release ---
+        raw[0] = 1'b0;
+        repeat (20) @(posedge clk);
+        expect_counts(1, 1, "release accepted");
+
+        $display("[%t ns] Input conditioner test complete, %0d failures.", $time, errors);
+        #50;
+        $finish;
+    end
+
+    initial begin
+        $dumpfile("input_conditioner_dump.vcd");
+        $dumpvars(0, tb_input_conditioner);
+    end
+
+endmodule
@@ -11,15 +11,24 @@ module tb_traffic_controller();
 
     wire [3:0] light;      // [3]:EW_Y, [2]:EW_G, [1]:NS_Y, [0]:NS_G
     wire [7:0] state_timer_out; // Match DUT output width
+    wire uart_tx;               // Transition telemetry, one bit per clock
+
+`ifdef STIMULUS_FILE
+    // Fuzzer stimulus is timed to the cycle against the unconditioned FSM
+    localparam CONDITION_INPUTS = 0;
+`else
+    localparam CONDITION_INPUTS = 1;
+`endif
 
     // Instantiate the traffic controller module
-    Traffic_Controller uut (
+    Traffic_Controller #(.CONDITION_INPUTS(CONDITION_INPUTS)) uut (
         .clk(clk),
         .reset(reset),
         .emergency(emergency),
         .traffic_sensors(traffic_sensors),
         .light(light),
-        .state_timer_out(state_timer_out)
+        .state_timer_out(state_timer_out),
+        .uart_tx(uart_tx)
     );
 
     // Clock generation (100 MHz)
@@ -31,6 +40,14 @@ module tb_traffic_controller();
         #(CLK_PERIOD / 2);
     end
 
+`ifdef STIMULUS_FILE
+    // Replay of simulation/host/stim_fuzz output. Word 0 is the record count,
+    // then one record per word: delay_cycles << 8 | {reset, emergency, sensors[3:0]}
+    localparam STIMULUS_DEPTH = 4096;
+    reg [31:0] stimulus_mem [0:STIMULUS_DEPTH-1];
+    integer rec;
+`endif
+
     // Simulation Control and Stimulus
     initial begin
         // --- Setup ---
@@ -43,6 +60,16 @@ module tb_traffic_controller();
         $display("[%t ns] Reset Released.", $time);
         @(posedge clk); // Wait one cycle for reset to propagate
 
+`ifdef STIMULUS_FILE
+        $readmemh(`STIMULUS_FILE, stimulus_mem);
+        $display("[%t ns] Replaying %0d stimulus records.", $time, stimulus_mem[0]);
+        for (rec = 1; rec <= stimulus_mem[0] && rec < STIMULUS_DEPTH; rec = rec + 1) begin
+            repeat (stimulus_mem[rec][31:8]) @(posedge clk);
+            reset = stimulus_mem[rec][5];
+            emergency = stimulus_mem[rec][4];
+            traffic_sensors = stimulus_mem[rec][3:0];
+        end
+`else
         // --- Scenario 1: NS Green (initial) -> EW Demand -> EW Green ---
         $display("[%t ns] Scenario 1: NS Green, then EW demand.", $time);
         traffic_sensors = 4'b0000; // No demand initially
@@ -75,6 +102,23 @@ module tb_traffic_controller();
         // Wait long enough for it to cycle back based on sensors (or lack thereof)
         #( (100 + 20 + 60 + 20 + 10) * CLK_PERIOD );
 
+        // --- Scenario 4: Stuck yellow timer trips the watchdog ---
+        $display("[%t ns] Scenario 4: Yellow timer stuck, expecting flash mode.", $time);
+        traffic_sensors = 4'b1100; // EW demand so NS Green ends
+        wait (uut.current_state == 3'b010); // NS_YELLOW
+        force uut.state_timer = 8'd7;       // Timer stops counting down
+        wait (uut.current_state == 3'b111); // FLASH
+        $display("[%t ns] Watchdog fired, flashing.", $time);
+        release uut.state_timer;
+        #( 40 * CLK_PERIOD ); // Watch a few flash periods
+        reset = 1'b1;
+        @(posedge clk);
+        reset = 1'b0;
+        #( 10 * CLK_PERIOD );
+        $display("[%t ns] Reset cleared flash mode. State=%b", $time, uut.current_state);
+
+`endif
+
         // --- Finish Simulation ---
         $display("[%t ns] Test scenarios complete. Finishing simulation.", $time);
         #50; // Extra delay before finishing
@@ -94,4 +138,38 @@ module tb_traffic_controller();
          $time, uut.current_state, light, traffic_sensors[3:0], state_timer_out, emergency);
     end
 
+`ifdef TELEMETRY_LOG
+    // UART receiver for the telemetry line (TELEMETRY_CLKS_PER_BIT = 1):
+    // writes each received byte as a hex line for simulation/host/telemetry_decode
+    integer tel_fd;
+    integer tel_bit;
+    reg [7:0] tel_byte;
+    initial begin
+        tel_fd = $fopen(`TELEMETRY_LOG, "w");
+        forever begin
+            @(posedge clk);
+            if (!reset && uart_tx == 1'b0) begin // Start bit
+                for (tel_bit = 0; tel_bit < 8; tel_bit = tel_bit + 1) begin
+                    @(posedge clk);
+                    tel_byte[tel_bit] = uart_tx;
+                end
+                @(posedge clk); // Stop bit
+                $fdisplay(tel_fd, "%02x", tel_byte);
+            end
+        end
+    end
+`endif
+
+`ifdef COVERAGE_LOG
+    // Coverage log for simulation/host/coverage_report: the values next_state
+    // was evaluated with at each clock edge
+    // Line format: reset emergency sensors[3:0] state timer_zero
+    integer cov_fd;
+    initial cov_fd = $fopen(`COVERAGE_LOG, "w");
+    always @(posedge clk) begin
+        $fdisplay(cov_fd, "%0d %0d %b %b %0d", reset, uut.emergency_c, uut.sensors_c,
+                  uut.current_state, state_timer_out == 0);
+    end
+`endif
+
 endmodule